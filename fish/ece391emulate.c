@@ -2,6 +2,7 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -176,6 +177,28 @@ ece391_vidmap (uint8_t** screen_start)
     return 0;
 }
 
+static uint8_t* back_buffer_screen = NULL;
+static uint8_t back_buffer[80 * 25 * 2];
+
+int32_t 
+ece391_vidmap_buffered (uint8_t** screen_start)
+{
+    if (NULL == back_buffer_screen && 0 != ece391_vidmap (&back_buffer_screen))
+        return -1;
+    memcpy (back_buffer, back_buffer_screen, sizeof (back_buffer));
+    *screen_start = back_buffer;
+    return 0;
+}
+
+int32_t 
+ece391_present (void)
+{
+    if (NULL == back_buffer_screen)
+        return -1;
+    memcpy (back_buffer_screen, back_buffer, sizeof (back_buffer));
+    return 0;
+}
+
 int32_t 
 ece391_read (int32_t fd, void* buf, int32_t nbytes)
 {
@@ -0,0 +1,198 @@
+/* host.c - Linux side of the hosted build
+ * vim:ts=4 noexpandtab
+ *
+ * Loads the file system image, then runs the kernel-side tests. Everything
+ * is built for i386 like the kernel and linked without libc, so this file
+ * starts the program and asks Linux for files and output itself, through
+ * int $0x80.
+ *
+ * usage: hosted [-b] filesys_img [fsdir]
+ *   -b   run the microbenchmarks after the unit tests
+ */
+
+#include "hosted.h"
+
+/* i386 Linux system call numbers */
+#define SYS_READ            3
+#define SYS_WRITE           4
+#define SYS_OPEN            5
+#define SYS_CLOSE           6
+
+#define O_RDONLY            0
+#define STDOUT              1
+#define STDERR              2
+
+#define IMAGE_MAX           (16 << 20)
+#define IMAGE_ALIGN         4096
+#define OUT_LEN             4096
+#define PATH_LEN            512
+
+static const char* fs_dir;
+static unsigned char image[IMAGE_MAX] __attribute__((aligned(IMAGE_ALIGN)));
+static char out_buf[OUT_LEN];
+static unsigned int out_len;
+
+int main(int argc, char* argv[]);
+
+/* _start
+ *
+ * DESCRIPTION: Entry point. Linux leaves argc and then argv on the stack;
+ *              main gets them as arguments and its result is the exit status
+ */
+asm (
+    ".globl _start              \n"
+    "_start:                    \n"
+    "    xorl   %ebp, %ebp      \n"
+    "    leal   4(%esp), %eax   \n"
+    "    pushl  %eax            \n"
+    "    pushl  4(%esp)         \n"
+    "    call   main            \n"
+    "    movl   %eax, %ebx      \n"
+    "    movl   $1, %eax        \n"     /* exit */
+    "    int    $0x80           \n"
+);
+
+/* linux_call
+ *
+ * DESCRIPTION: Makes a system call with up to three arguments
+ * INPUTS: nr - system call number, a, b, c - its arguments
+ * OUTPUTS: the call's result, -errno on failure
+ */
+static int linux_call(int nr, int a, int b, int c) {
+    int ret;
+
+    asm volatile ("int $0x80"
+                  : "=a" (ret)
+                  : "a" (nr), "b" (a), "c" (b), "d" (c)
+                  : "memory");
+    return ret;
+}
+
+/* host_strlen
+ *
+ * DESCRIPTION: strlen for this file, which can't see the kernel's headers
+ */
+static unsigned int host_strlen(const char* s) {
+    unsigned int len = 0;
+
+    while (s[len] != '\0') len++;
+    return len;
+}
+
+/* host_flush
+ *
+ * DESCRIPTION: Writes out what host_putc has buffered
+ */
+static void host_flush(void) {
+    if (out_len != 0) linux_call(SYS_WRITE, STDOUT, (int)out_buf, out_len);
+    out_len = 0;
+}
+
+/* host_error
+ *
+ * DESCRIPTION: Reports a failure on stderr, after any pending output
+ * INPUTS: what, why - the two halves of the message
+ */
+static void host_error(const char* what, const char* why) {
+    host_flush();
+    linux_call(SYS_WRITE, STDERR, (int)what, host_strlen(what));
+    linux_call(SYS_WRITE, STDERR, (int)why, host_strlen(why));
+}
+
+/* host_putc
+ *
+ * DESCRIPTION: Console output of the kernel side. lib.c mirrors putc to
+ *              serial_putc, which the stubs send here
+ * INPUTS: c - character to write
+ * OUTPUTS: None
+ */
+void host_putc(char c) {
+    out_buf[out_len++] = c;
+    if (out_len == OUT_LEN) host_flush();
+}
+
+/* read_file
+ *
+ * DESCRIPTION: Reads a whole file, or as much of it as fits
+ * INPUTS: path - file name
+ *         buf  - destination
+ *         size - most bytes to read
+ * OUTPUTS: bytes read, or -1 if the file can't be opened
+ */
+static int read_file(const char* path, unsigned char* buf, unsigned int size) {
+    int fd, n;
+    unsigned int len = 0;
+
+    if ((fd = linux_call(SYS_OPEN, (int)path, O_RDONLY, 0)) < 0) return -1;
+    while (len < size && (n = linux_call(SYS_READ, fd, (int)(buf + len), size - len)) > 0) {
+        len += n;
+    }
+    linux_call(SYS_CLOSE, fd, 0, 0);
+    return (int)len;
+}
+
+/* host_read_fsdir
+ *
+ * DESCRIPTION: Reads a file from the directory the image was built from,
+ *              so the image's contents can be checked against it
+ * INPUTS: name - file name
+ *         buf  - destination
+ *         size - most bytes to read
+ * OUTPUTS: bytes read, or -1 if there is no such file
+ */
+int host_read_fsdir(const char* name, unsigned char* buf, unsigned int size) {
+    char path[PATH_LEN];
+    unsigned int dir_len, name_len, i;
+
+    if (fs_dir == 0) return -1;
+    dir_len = host_strlen(fs_dir);
+    name_len = host_strlen(name);
+    if (dir_len + 1 + name_len >= PATH_LEN) return -1;
+
+    for (i = 0; i < dir_len; i++) path[i] = fs_dir[i];
+    path[dir_len] = '/';
+    for (i = 0; i <= name_len; i++) path[dir_len + 1 + i] = name[i];
+    return read_file(path, buf, size);
+}
+
+/* load_image
+ *
+ * DESCRIPTION: Reads the file system image into memory, page aligned as
+ *              the boot loader leaves it
+ * INPUTS: path - image file
+ * OUTPUTS: address of the image, or 0 on failure
+ */
+static unsigned int load_image(const char* path) {
+    int len = read_file(path, image, IMAGE_MAX);
+
+    if (len < 0) {
+        host_error(path, ": cannot open\n");
+        return 0;
+    }
+    if (len == IMAGE_MAX) {
+        host_error(path, ": image too large\n");
+        return 0;
+    }
+    return (unsigned int)image;
+}
+
+int main(int argc, char* argv[]) {
+    int arg = 1, run_bench = 0, failures;
+    unsigned int fs_addr;
+
+    if (arg < argc && argv[arg][0] == '-' && argv[arg][1] == 'b' && argv[arg][2] == '\0') {
+        run_bench = 1;
+        arg++;
+    }
+    if (arg >= argc) {
+        host_error(argv[0], ": usage: hosted [-b] filesys_img [fsdir]\n");
+        return 2;
+    }
+    if ((fs_addr = load_image(argv[arg++])) == 0) return 2;
+    if (arg < argc) fs_dir = argv[arg];
+
+    failures = hosted_main(fs_addr, run_bench);
+
+    host_flush();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+/* hosted.h - Interface between the host shim and the kernel-side files
+ * vim:ts=4 noexpandtab
+ *
+ * Included from both sides, so only plain C types are used: the kernel's
+ * types.h and the host's <stdint.h> can't share a translation unit.
+ */
+
+#ifndef _HOSTED_H
+#define _HOSTED_H
+
+/* Host services, in host.c */
+
+/* Write a character to stdout */
+void host_putc(char c);
+/* Read up to size bytes of a file from the fsdir directory, -1 if missing */
+int host_read_fsdir(const char* name, unsigned char* buf, unsigned int size);
+
+/* Kernel-side entry point, in tests.c. fs_addr is the loaded file system
+ * image. Returns the number of failed tests */
+int hosted_main(unsigned int fs_addr, int bench);
+
+#endif /* _HOSTED_H */
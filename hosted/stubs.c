@@ -0,0 +1,57 @@
+/* stubs.c - Kernel functions the hosted files call but that live in parts
+ * of the kernel not built for the host
+ * vim:ts=4 noexpandtab
+ */
+
+#include "types.h"
+#include "syscalls.h"
+#include "scrollback.h"
+#include "serial.h"
+#include "fpu.h"
+#include "sched.h"
+#include "hosted.h"
+
+/* Stands in for the running process of the fd-based filesys calls */
+static pcb_t host_pcb;
+
+pcb_t* get_current_PCB() {
+    return &host_pcb;
+}
+
+/* The keyboard buffer is always empty, so putc never holds output back */
+uint32_t get_key_index(void) {
+    return 0;
+}
+
+/* No scrollback history is kept */
+void scrollback_push(uint32_t term, const uint16_t* row) {
+}
+
+uint32_t scrollback_count(uint32_t term) {
+    return 0;
+}
+
+void scrollback_line(uint32_t term, uint32_t back, uint16_t* cells) {
+}
+
+/* Console output is mirrored here (SERIAL_LOG); send it to stdout */
+void serial_putc(uint8_t c) {
+    host_putc((char)c);
+}
+
+/* fpu_init needs ring 0 and never runs, so memcpy/memset keep to rep movs */
+uint32_t simd_enabled;
+
+void kernel_fpu_begin(void) {
+}
+
+void kernel_fpu_end(void) {
+}
+
+/* The stand-in process is the only one, so nothing could wake a sleeper */
+int32_t sleep_on(wait_queue_t* wq) {
+    return -1;
+}
+
+void wake_up(wait_queue_t* wq) {
+}
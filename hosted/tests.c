@@ -0,0 +1,977 @@
+/* tests.c - Unit tests and microbenchmarks run by the hosted build
+ * vim:ts=4 noexpandtab
+ *
+ * Kernel-side file: built with the kernel's headers and flags.
+ */
+
+#include "tests.h"
+#include "types.h"
+#include "lib.h"
+#include "filesys.h"
+#include "simd.h"
+#include "pipe.h"
+#include "utils/arg_util.h"
+#include "utils/char_util.h"
+#include "hosted.h"
+
+#define VIDEO_PAGE      4096
+#define BUF_SIZE        65536
+#define CHUNK           1000    /* odd size so reads straddle blocks */
+#define NUM_LEN         16
+#define MAX_BUFF_LEN    128     /* command line length, as in terminal.h */
+#define DEC             10
+
+/* Files whose fsdir copy is known to match the shipped image */
+static const int8_t* fsdir_files[] = {
+    "frame0.txt", "frame1.txt", "verylargetextwithverylongname.txt"
+};
+#define NUM_FSDIR_FILES (sizeof(fsdir_files) / sizeof(fsdir_files[0]))
+
+/* The SSE2 kernels need an aligned destination */
+static uint8_t buf_a[BUF_SIZE] __attribute__((aligned(16)));
+static uint8_t buf_b[BUF_SIZE] __attribute__((aligned(16)));
+
+/* Unit tests */
+
+/* String utils test
+ *
+ * Asserts string_length, string_equal, copy_string and substring on
+ * empty, short and odd-length strings
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: utils/char_util.c
+ */
+static int32_t char_util_test() {
+    TEST_HEADER;
+
+    uint8_t buf[FNAME_MAX_LEN + 1];
+
+    if (string_length(dechar("")) != 0) return FAIL;
+    if (string_length(dechar("shell")) != 5) return FAIL;
+    if (string_length(dechar("verylargetextwithverylongname.txt")) != 33) return FAIL;
+
+    if (string_equal(dechar("shell"), dechar("shell")) != 1) return FAIL;
+    if (string_equal(dechar("shell"), dechar("shel")) == 1) return FAIL;
+    if (string_equal(dechar("shel"), dechar("shell")) == 1) return FAIL;
+    if (string_equal(dechar(""), dechar("")) != 1) return FAIL;
+
+    if (copy_string(dechar("counter"), buf) != 0) return FAIL;
+    if (string_equal(buf, dechar("counter")) != 1) return FAIL;
+
+    if (substring(dechar("pingpong"), buf, 4, 8) < 0) return FAIL;
+    if (string_equal(buf, dechar("pong")) != 1) return FAIL;
+
+    return PASS;
+}
+
+/* lib string test
+ *
+ * Asserts strlen, strncmp, strcpy, strncpy and itoa
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: lib.c
+ */
+static int32_t lib_string_test() {
+    TEST_HEADER;
+
+    int8_t buf[NUM_LEN];
+
+    if (strlen("") != 0 || strlen("391OS> ") != 7) return FAIL;
+    if (strncmp("cat", "cat", 4) != 0) return FAIL;
+    if (strncmp("cat", "car", 3) <= 0) return FAIL;
+    if (strncmp("cat", "catch", 3) != 0) return FAIL;
+    if (strncmp("cat", "catch", 4) >= 0) return FAIL;
+
+    strcpy(buf, "grep");
+    if (strncmp(buf, "grep", NUM_LEN) != 0) return FAIL;
+    memset(buf, 'z', NUM_LEN);
+    strncpy(buf, "ls", 4);
+    if (buf[2] != '\0' || buf[3] != '\0' || buf[4] != 'z') return FAIL;
+
+    if (strncmp(itoa(0, buf, DEC), "0", NUM_LEN) != 0) return FAIL;
+    if (strncmp(itoa(4294967295U, buf, DEC), "4294967295", NUM_LEN) != 0) return FAIL;
+    if (strncmp(itoa(0xB8000, buf, 16), "B8000", NUM_LEN) != 0) return FAIL;
+
+    return PASS;
+}
+
+/* lib memory test
+ *
+ * Asserts memcpy, memset and memmove at every alignment of source,
+ * destination and length around a word, checking the bytes around the
+ * target are untouched
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Overwrites buf_a, buf_b
+ * Coverage: lib.c
+ */
+static int32_t lib_memory_test() {
+    TEST_HEADER;
+
+    uint32_t src, dst, len, i;
+
+    for (i = 0; i < 256; i++) buf_a[i] = i;
+
+    for (src = 0; src < 4; src++) {
+        for (dst = 0; dst < 4; dst++) {
+            for (len = 0; len < 70; len++) {
+                memset(buf_b, 0xEE, 128);
+                memcpy(buf_b + 8 + dst, buf_a + src, len);
+                for (i = 0; i < 128; i++) {
+                    if (i >= 8 + dst && i < 8 + dst + len) {
+                        if (buf_b[i] != buf_a[src + i - 8 - dst]) return FAIL;
+                    } else if (buf_b[i] != 0xEE) {
+                        return FAIL;
+                    }
+                }
+
+                memset(buf_b + 8 + dst, src, len);
+                for (i = 8 + dst; i < 8 + dst + len; i++) {
+                    if (buf_b[i] != src) return FAIL;
+                }
+                if (buf_b[7 + dst] != 0xEE || buf_b[8 + dst + len] != 0xEE) return FAIL;
+            }
+        }
+    }
+
+    /* Overlapping moves in both directions */
+    for (i = 0; i < 64; i++) buf_b[i] = i;
+    memmove(buf_b + 3, buf_b, 32);
+    for (i = 0; i < 32; i++) {
+        if (buf_b[i + 3] != i) return FAIL;
+    }
+    for (i = 0; i < 64; i++) buf_b[i] = i;
+    memmove(buf_b, buf_b + 3, 32);
+    for (i = 0; i < 32; i++) {
+        if (buf_b[i] != i + 3) return FAIL;
+    }
+
+    return PASS;
+}
+
+/* The byte-at-a-time loops the word versions replaced, kept as a reference
+ * for the tests and as the baseline of the string benchmarks */
+static uint32_t byte_strlen(const int8_t* s) {
+    uint32_t len = 0;
+    while (s[len] != '\0') len++;
+    return len;
+}
+
+static int32_t byte_strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        if ((s1[i] != s2[i]) || (s1[i] == '\0')) return s1[i] - s2[i];
+    }
+    return 0;
+}
+
+static int32_t byte_string_equal(const uint8_t* s1, const uint8_t* s2) {
+    int32_t i;
+    for (i = 0; (s1[i] != '\0') && (s2[i] != '\0'); i++) {
+        if (s1[i] != s2[i]) return 0;
+    }
+    return (s1[i] == '\0') && (s2[i] == '\0');
+}
+
+static int32_t byte_copy_string(const uint8_t* source, uint8_t* dest) {
+    while ((*dest++ = *source++) != '\0');
+    return 0;
+}
+
+/* Word string test
+ *
+ * Asserts the word-at-a-time string functions agree with the byte loops
+ * for every alignment of both strings, lengths across several words, and
+ * a difference at every position
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Overwrites buf_a, buf_b
+ * Coverage: strlen, strncmp, strncpy, string_length, string_equal,
+ *           copy_string
+ * Files: lib.c, utils/char_util.c
+ */
+static int32_t word_string_test() {
+    TEST_HEADER;
+
+    uint32_t a, b, len, diff, n, i;
+    int8_t *s1, *s2;
+
+    for (a = 0; a < 4; a++) {
+        for (b = 0; b < 4; b++) {
+            for (len = 0; len < 40; len++) {
+                s1 = (int8_t*)buf_a + a;
+                s2 = (int8_t*)buf_b + b;
+                for (i = 0; i < len; i++) s1[i] = s2[i] = 'a' + (i % 26);
+                s1[len] = s2[len] = '\0';
+                /* Junk after the terminator must not matter */
+                s1[len + 1] = 'x';
+                s2[len + 1] = 'y';
+
+                if (strlen(s1) != len || string_length((uint8_t*)s2) != len) return FAIL;
+                if (string_equal((uint8_t*)s1, (uint8_t*)s2) != 1) return FAIL;
+                if (strncmp(s1, s2, len + 2) != 0) return FAIL;
+
+                for (diff = 0; diff <= len; diff++) {
+                    s2[diff] = (diff == len) ? 'z' : s1[diff] + 1;
+                    if (string_equal((uint8_t*)s1, (uint8_t*)s2) != 0) return FAIL;
+                    for (n = 0; n <= len + 1; n++) {
+                        if (strncmp(s1, s2, n) != byte_strncmp(s1, s2, n)) return FAIL;
+                        if (strncmp(s2, s1, n) != byte_strncmp(s2, s1, n)) return FAIL;
+                    }
+                    s2[diff] = (diff == len) ? '\0' : s1[diff];
+                }
+
+                memset(buf_b, 'z', 64);
+                copy_string((uint8_t*)s1, (uint8_t*)s2);
+                if (strncmp(s1, s2, len + 1) != 0 || s2[len + 1] != 'z') return FAIL;
+
+                for (n = 0; n < len + 8; n++) {
+                    memset(buf_b, 'z', 64);
+                    strncpy(s2, s1, n);
+                    for (i = 0; i < n; i++) {
+                        if (s2[i] != ((i < len) ? s1[i] : '\0')) return FAIL;
+                    }
+                    if (s2[n] != 'z') return FAIL;
+                }
+            }
+        }
+    }
+
+    return PASS;
+}
+
+/* SIMD copy test
+ *
+ * Asserts the SSE2 copy and fill kernels, with and without non-temporal
+ * stores, against every source alignment, touching nothing past the end.
+ * fpu.c can't run in user space, so lib.c's memcpy/memset stay on the
+ * rep movs path here and the kernels are called directly
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Overwrites buf_a, buf_b
+ * Coverage: sse2_memcpy, sse2_memset
+ * Files: simd.c
+ */
+static int32_t simd_copy_test() {
+    TEST_HEADER;
+
+    uint32_t src, len, stream, i;
+
+    for (i = 0; i < BUF_SIZE; i++) buf_a[i] = i * 7;
+
+    for (stream = 0; stream < 2; stream++) {
+        for (src = 0; src < 16; src++) {
+            for (len = 0; len <= 4096; len += 64) {
+                memset(buf_b, 0xEE, len + 64);
+                sse2_memcpy(buf_b, buf_a + src, len, stream);
+                for (i = 0; i < len; i++) {
+                    if (buf_b[i] != buf_a[src + i]) return FAIL;
+                }
+                for (; i < len + 64; i++) {
+                    if (buf_b[i] != 0xEE) return FAIL;
+                }
+
+                sse2_memset(buf_b, src, len, stream);
+                for (i = 0; i < len; i++) {
+                    if (buf_b[i] != src) return FAIL;
+                }
+                if (buf_b[len] != 0xEE) return FAIL;
+            }
+        }
+    }
+
+    return PASS;
+}
+
+/* Argument util test
+ *
+ * Runs the argument parser's own self test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: utils/arg_util.c
+ */
+static int32_t arg_util_test() {
+    TEST_HEADER;
+
+    return test_arg_util() ? PASS : FAIL;
+}
+
+/* Tokenizer test
+ *
+ * Asserts parse_arguments finds the same words as get_argument, and fails
+ * when there are more words than room
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: parse_arguments
+ * Files: utils/arg_util.c
+ */
+static int32_t parse_arguments_test() {
+    TEST_HEADER;
+
+    static const int8_t* lines[] = {
+        "", "   ", "shell", "  cat  frame0.txt ", "grep a b  c   d", " x"
+    };
+    arg_t argv[MAX_ARGS];
+    uint8_t word[MAX_BUFF_LEN];
+    int32_t argc, len;
+    uint32_t l, i;
+
+    for (l = 0; l < sizeof(lines) / sizeof(lines[0]); l++) {
+        argc = parse_arguments(dechar(lines[l]), argv, MAX_ARGS);
+        if (argc != get_argument_count(dechar(lines[l]))) return FAIL;
+        for (i = 0; i < argc; i++) {
+            len = get_argument(dechar(lines[l]), i, word);
+            if (len != argv[i].length) return FAIL;
+            if (strncmp((int8_t*)word, lines[l] + argv[i].offset, len) != 0) return FAIL;
+        }
+    }
+
+    if (parse_arguments(dechar("a b c"), argv, 2) != -1) return FAIL;
+    if (parse_arguments(NULL, argv, MAX_ARGS) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* Directory entry test
+ *
+ * Asserts every entry found by index is found again by name, and that
+ * missing and empty names fail
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: read_dentry_by_index, read_dentry_by_name
+ * Files: filesys.c
+ */
+static int32_t dentry_test() {
+    TEST_HEADER;
+
+    dentry_t by_index, by_name;
+    uint8_t name[FNAME_MAX_LEN + 1];
+    uint32_t i;
+
+    if (read_dentry_by_index(0, &by_index) != 0) return FAIL;
+    for (i = 0; read_dentry_by_index(i, &by_index) == 0; i++) {
+        /* Names of the full 32 characters aren't terminated */
+        memcpy(name, by_index.name, FNAME_MAX_LEN);
+        name[FNAME_MAX_LEN] = '\0';
+        if (read_dentry_by_name(name, &by_name) != 0) return FAIL;
+        if (by_name.inode_index != by_index.inode_index) return FAIL;
+        if (by_name.file_type != by_index.file_type) return FAIL;
+    }
+
+    if (read_dentry_by_name(dechar("nosuchfile"), &by_name) != -1) return FAIL;
+    if (read_dentry_by_name(dechar(""), &by_name) != -1) return FAIL;
+    if (read_dentry_by_name(dechar("fis"), &by_name) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* File data test
+ *
+ * Reads files whole and in chunks that straddle block boundaries, and
+ * compares them with their copies in fsdir when those are available
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Overwrites buf_a, buf_b
+ * Coverage: read_data, file_size
+ * Files: filesys.c
+ */
+static int32_t read_data_test() {
+    TEST_HEADER;
+
+    dentry_t dentry;
+    uint32_t f, off, size;
+    int32_t n, host_n;
+
+    for (f = 0; f < NUM_FSDIR_FILES; f++) {
+        if (read_dentry_by_name(dechar(fsdir_files[f]), &dentry) != 0) return FAIL;
+
+        size = file_size(dechar(fsdir_files[f]));
+        if (read_data(dentry.inode_index, 0, buf_a, BUF_SIZE) != size) return FAIL;
+
+        /* Chunked reads must give the same bytes and stop at the end */
+        for (off = 0; off < size; off += n) {
+            n = read_data(dentry.inode_index, off, buf_b + off, CHUNK);
+            if (n <= 0) return FAIL;
+        }
+        if (off != size) return FAIL;
+        if (read_data(dentry.inode_index, size, buf_b, CHUNK) != 0) return FAIL;
+        for (off = 0; off < size; off++) {
+            if (buf_a[off] != buf_b[off]) return FAIL;
+        }
+
+        host_n = host_read_fsdir(fsdir_files[f], buf_b, BUF_SIZE);
+        if (host_n < 0) continue;
+        if (host_n != size) return FAIL;
+        for (off = 0; off < size; off++) {
+            if (buf_a[off] != buf_b[off]) return FAIL;
+        }
+    }
+
+    if (read_data(-1, 0, buf_a, CHUNK) != -1) return FAIL;
+    if (read_data(dentry.inode_index, 0, NULL, CHUNK) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* Data span test
+ *
+ * Walking a file with data_span, as sendfile does, must give the bytes
+ * read_data copies, in spans that never cross a data block
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: data_span
+ */
+static int32_t data_span_test() {
+    TEST_HEADER;
+
+    dentry_t dentry;
+    const uint8_t* span;
+    uint32_t f, off, size;
+    int32_t n;
+
+    for (f = 0; f < NUM_FSDIR_FILES; f++) {
+        if (read_dentry_by_name(dechar(fsdir_files[f]), &dentry) != 0) return FAIL;
+        size = read_data(dentry.inode_index, 0, buf_a, BUF_SIZE);
+
+        for (off = 0; off < size; off += n) {
+            n = data_span(dentry.inode_index, off, &span);
+            if (n <= 0 || n > BLOCK_SIZE - (off & BLOCK_MASK)) return FAIL;
+            memcpy(buf_b + off, span, n);
+        }
+        if (data_span(dentry.inode_index, size, &span) != 0) return FAIL;
+        for (off = 0; off < size; off++) {
+            if (buf_a[off] != buf_b[off]) return FAIL;
+        }
+    }
+
+    if (data_span(-1, 0, &span) != -1) return FAIL;
+    if (data_span(dentry.inode_index, 0, NULL) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* Directory read test
+ *
+ * Two descriptors listing the directory at once keep separate places, and
+ * read_dirents, in batches of any size, gives the same entries along with
+ * each regular file's size
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses descriptors 2 and 3 of the stand-in process
+ * Coverage: dir_read, read_dirents
+ */
+static int32_t dir_read_test() {
+    TEST_HEADER;
+
+    fd_t* fa = get_current_PCB()->file_array;
+    dirent_t dirents[DENTRY_COUNT];
+    dentry_t dentry;
+    uint32_t cursor, count, batch, i, size;
+    int32_t n, j;
+
+    /* Interleaved listings */
+    fa[2].pos = 0;
+    fa[3].pos = 0;
+    for (count = 0; read_dentry_by_index(count, &dentry) == 0; count++) {
+        if (dir_read(2, buf_a, BUF_SIZE) != FNAME_MAX_LEN) return FAIL;
+        if (count % 2 == 0 && dir_read(3, buf_b, FNAME_MAX_LEN) != FNAME_MAX_LEN) return FAIL;
+        if (strncmp((int8_t*)buf_a, (int8_t*)dentry.name, FNAME_MAX_LEN) != 0) return FAIL;
+    }
+    if (dir_read(2, buf_a, BUF_SIZE) != 0 || fa[2].pos != 0) return FAIL;
+    if (fa[3].pos != (count + 1) / 2) return FAIL;
+
+    for (batch = 1; batch <= DENTRY_COUNT; batch += 6) {
+        cursor = 0;
+        for (i = 0; (n = read_dirents(&cursor, dirents, batch)) > 0; i += n) {
+            if (n > batch || cursor != i + n) return FAIL;
+            for (j = 0; j < n; j++) {
+                if (read_dentry_by_index(i + j, &dentry) != 0) return FAIL;
+                if (strncmp((int8_t*)dirents[j].name, (int8_t*)dentry.name, FNAME_MAX_LEN) != 0) return FAIL;
+                if (dirents[j].file_type != dentry.file_type) return FAIL;
+                if (dirents[j].inode_index != dentry.inode_index) return FAIL;
+                size = (dentry.file_type == FILE_TYPE_REGULAR) ? file_size(dentry.name) : 0;
+                if (dirents[j].size != size) return FAIL;
+            }
+        }
+        if (n != 0 || i != count) return FAIL;
+    }
+    if (read_dirents(NULL, dirents, 1) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* Stat test
+ *
+ * The cached metadata stat_dentry reports must match what read_data finds
+ * in every file, with blocks enough to hold it; the rtc and directory have
+ * no size
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: stat_dentry, stat_inode, file_size
+ */
+static int32_t stat_test() {
+    TEST_HEADER;
+
+    dentry_t dentry;
+    stat_t st;
+    uint32_t i;
+
+    for (i = 0; read_dentry_by_index(i, &dentry) == 0; i++) {
+        if (stat_dentry(&dentry, &st) != 0) return FAIL;
+        if (st.file_type != dentry.file_type) return FAIL;
+        if (st.inode_index != dentry.inode_index) return FAIL;
+        if (dentry.file_type != FILE_TYPE_REGULAR) {
+            if (st.size != 0 || st.blocks != 0) return FAIL;
+            continue;
+        }
+        if (st.size != read_data(dentry.inode_index, 0, buf_a, BUF_SIZE)) return FAIL;
+        if (st.size != file_size(dentry.name)) return FAIL;
+        if (st.blocks * BLOCK_SIZE < st.size) return FAIL;
+        if (st.blocks > 0 && (st.blocks - 1) * BLOCK_SIZE >= st.size) return FAIL;
+    }
+
+    if (stat_dentry(NULL, &st) != -1) return FAIL;
+    if (stat_inode(-1, &st) != -1) return FAIL;
+    if (stat_inode(0, NULL) != -1) return FAIL;
+
+    return PASS;
+}
+
+/* Seek test
+ *
+ * lseek from each origin, and pread at every offset of a file, must agree
+ * with read_data without pread moving the position
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses descriptor 2 of the stand-in process
+ * Coverage: file_lseek, file_pread, file_read
+ */
+static int32_t seek_test() {
+    TEST_HEADER;
+
+    fd_t* fa = get_current_PCB()->file_array;
+    dentry_t dentry;
+    uint32_t size, off, i, n;
+
+    if (read_dentry_by_name(dechar("fish"), &dentry) != 0) return FAIL;
+    size = read_data(dentry.inode_index, 0, buf_a, BUF_SIZE);
+    fa[2].inode = dentry.inode_index;
+    fa[2].pos = 0;
+
+    if (file_lseek(2, -CHUNK, SEEK_END) != size - CHUNK) return FAIL;
+    if (file_read(2, buf_b, BUF_SIZE) != CHUNK) return FAIL;
+    for (i = 0; i < CHUNK; i++) {
+        if (buf_b[i] != buf_a[size - CHUNK + i]) return FAIL;
+    }
+    if (file_lseek(2, CHUNK, SEEK_SET) != CHUNK) return FAIL;
+    if (file_lseek(2, -1, SEEK_CUR) != CHUNK - 1) return FAIL;
+    if (file_lseek(2, CHUNK, SEEK_END) != size + CHUNK) return FAIL;
+    if (file_read(2, buf_b, 1) != 0) return FAIL;
+
+    /* Failed seeks leave the position */
+    if (file_lseek(2, -(int32_t)size - CHUNK - 1, SEEK_CUR) != -1) return FAIL;
+    if (file_lseek(2, 0, 3) != -1) return FAIL;
+    if (file_lseek(2, 0, SEEK_CUR) != size + CHUNK) return FAIL;
+
+    for (off = 0; off < size; off += CHUNK / 3) {
+        n = (size - off < CHUNK) ? size - off : CHUNK;
+        if (file_pread(2, buf_b, CHUNK, off) != n) return FAIL;
+        for (i = 0; i < n; i++) {
+            if (buf_b[i] != buf_a[off + i]) return FAIL;
+        }
+    }
+    if (file_pread(2, buf_b, CHUNK, size) != 0) return FAIL;
+    if (file_pread(2, buf_b, -1, 0) != -1) return FAIL;
+    if (fa[2].pos != size + CHUNK) return FAIL;
+
+    return PASS;
+}
+
+/* Pipe test
+ *
+ * Runs a pipe through the host stand-in process. There is no other process
+ * to switch to, so a read of an empty pipe or a write to a full one fails
+ * where the kernel would sleep. Asserts the ring wraps, short reads and
+ * writes, end of file and the end counts kept by pipe_dup
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses descriptors 2 to 4 of the stand-in process
+ * Coverage: pipe.c
+ */
+static int32_t pipe_test() {
+    TEST_HEADER;
+
+    fd_t* fa = get_current_PCB()->file_array;
+    uint32_t i, round;
+
+    for (i = 0; i < BUF_SIZE; i++) buf_a[i] = (uint8_t)(i * 7 + 3);
+    if (pipe_alloc(&fa[2], &fa[3]) != 0) return FAIL;
+    if (!is_pipe(&fa[2]) || !is_pipe(&fa[3])) return FAIL;
+
+    /* Odd sizes so the ring wraps at a different offset every round */
+    for (round = 0; round < 8; round++) {
+        if (fa[3].fops->write(3, buf_a + round, CHUNK * 3) != CHUNK * 3) return FAIL;
+        if (fa[2].fops->read(2, buf_b, CHUNK) != CHUNK) return FAIL;
+        if (fa[2].fops->read(2, buf_b + CHUNK, BUF_SIZE) != CHUNK * 2) return FAIL;
+        for (i = 0; i < CHUNK * 3; i++) {
+            if (buf_b[i] != buf_a[round + i]) return FAIL;
+        }
+    }
+
+    /* Full after one page; empty with a writer left would sleep */
+    if (fa[3].fops->write(3, buf_a, PIPE_SIZE + CHUNK) != PIPE_SIZE) return FAIL;
+    if (fa[3].fops->write(3, buf_a, 1) != -1) return FAIL;
+    if (fa[2].fops->read(2, buf_b, BUF_SIZE) != PIPE_SIZE) return FAIL;
+    if (fa[2].fops->read(2, buf_b, 1) != -1) return FAIL;
+    if (fa[2].fops->read(2, buf_b, 0) != 0) return FAIL;
+
+    /* Wrong direction */
+    if (fa[2].fops->write(2, buf_a, 1) != -1) return FAIL;
+    if (fa[3].fops->read(3, buf_b, 1) != -1) return FAIL;
+
+    /* End of file only once every copy of the write end is closed */
+    fa[4] = fa[3];
+    pipe_dup(&fa[4]);
+    if (fa[3].fops->write(3, buf_a, CHUNK) != CHUNK) return FAIL;
+    if (fa[3].fops->close(3) != 0) return FAIL;
+    if (fa[2].fops->read(2, buf_b, BUF_SIZE) != CHUNK) return FAIL;
+    if (fa[2].fops->read(2, buf_b, 1) != -1) return FAIL;
+    if (fa[4].fops->close(4) != 0) return FAIL;
+    if (fa[2].fops->read(2, buf_b, 1) != 0) return FAIL;
+    if (fa[2].fops->close(2) != 0) return FAIL;
+
+    /* Writing with no reader left fails */
+    if (pipe_alloc(&fa[2], &fa[3]) != 0) return FAIL;
+    if (fa[2].fops->close(2) != 0) return FAIL;
+    if (fa[3].fops->write(3, buf_a, 1) != -1) return FAIL;
+    if (fa[3].fops->close(3) != 0) return FAIL;
+
+    /* Closed pipes are handed out again */
+    for (i = 0; i < MAX_PIPES; i++) {
+        if (pipe_alloc(&fa[2], &fa[3]) != 0) return FAIL;
+    }
+    if (pipe_alloc(&fa[2], &fa[3]) != -1) return FAIL;
+    for (i = 0; i < MAX_PIPES; i++) {
+        fa[2].inode = fa[3].inode = i;
+        fa[2].fops->close(2);
+        fa[3].fops->close(3);
+    }
+    if (pipe_alloc(&fa[2], &fa[3]) != 0) return FAIL;
+    fa[2].fops->close(2);
+    fa[3].fops->close(3);
+
+    return PASS;
+}
+
+/* Microbenchmarks
+ *
+ * Same names and line format as tests/benchmark.c in the kernel:
+ *
+ *   @bench <name> <iterations> <min> <median> <p99>
+ *
+ * and timed the same way, in time-stamp counter cycles.
+ */
+
+#define BENCH_ITERS     4096
+#define P99             99
+#define PERCENT         100
+
+static uint32_t samples[BENCH_ITERS];
+
+/* Time body iters times, then report it under name */
+#define BENCH(name, iters, body)                                    \
+do {                                                                \
+    uint32_t iter_;                                                 \
+    uint64_t start_;                                                \
+    for (iter_ = 0; iter_ < (iters); iter_++) {                     \
+        start_ = rdtsc();                                           \
+        body;                                                       \
+        samples[iter_] = (uint32_t)(rdtsc() - start_);              \
+    }                                                               \
+    bench_report((name), (iters));                                  \
+} while (0)
+
+/* bench_report
+ *
+ * Sorts the samples and prints the benchmark's line
+ * Inputs: name, iters - number of samples taken
+ * Outputs: None
+ */
+static void bench_report(const int8_t* name, uint32_t iters) {
+    uint32_t i, j, key;
+
+    /* Insertion sort is too slow for this many samples; shell sort */
+    for (i = iters / 2; i > 0; i /= 2) {
+        for (j = i; j < iters; j++) {
+            key = samples[j];
+            for (; j >= i && samples[j - i] > key; j -= i) {
+                samples[j] = samples[j - i];
+            }
+            samples[j] = key;
+        }
+    }
+
+    printf("@bench %s %u %u %u %u\n", name, iters, samples[0],
+           samples[iters / 2], samples[(iters * P99) / PERCENT]);
+}
+
+/* cat
+ *
+ * What cat costs besides the system call entries: read_data into a 1 kB
+ * user buffer that write then renders, or sendfile handing data_span's
+ * blocks over in place. Both end in one copy into buf_b, which stands in
+ * for video memory or a pipe
+ */
+static void cat_read_write(uint32_t inode, uint32_t size) {
+    static uint8_t user_buf[1024];
+    uint32_t off;
+    int32_t n;
+
+    for (off = 0; off < size; off += n) {
+        n = read_data(inode, off, user_buf, sizeof(user_buf));
+        memcpy(buf_b + off, user_buf, n);
+    }
+}
+
+static void cat_sendfile(uint32_t inode, uint32_t size) {
+    const uint8_t* span;
+    uint32_t off;
+    int32_t n;
+
+    for (off = 0; off < size; off += n) {
+        n = data_span(inode, off, &span);
+        memcpy(buf_b + off, span, n);
+    }
+}
+
+/* tail
+ *
+ * The last 64 bytes of a file, read through to the end in 1 kB reads as
+ * a program without lseek must, or with a single pread
+ */
+#define TAIL            64
+
+static void tail_read(uint32_t inode, uint32_t size) {
+    static uint8_t user_buf[1024];
+    uint32_t off;
+    int32_t n;
+
+    for (off = 0; off < size; off += n) {
+        n = read_data(inode, off, user_buf, sizeof(user_buf));
+        if (n <= 0) break;
+    }
+}
+
+static void tail_pread(uint32_t inode, uint32_t size) {
+    read_data(inode, size - TAIL, buf_b, TAIL);
+}
+
+/* File system benchmarks
+ *
+ * Coverage: read_data at several sizes, read_dentry_by_name, cat through
+ * read/write against sendfile
+ * Files: filesys.c
+ */
+static void bench_filesys() {
+    dentry_t dentry;
+    uint32_t size;
+
+    /* fish is the only file larger than the biggest read */
+    if (read_dentry_by_name(dechar("fish"), &dentry) != 0) {
+        printf("bench: fish missing\n");
+        return;
+    }
+
+    BENCH("read_data_64", BENCH_ITERS, read_data(dentry.inode_index, 0, buf_b, 64));
+    BENCH("read_data_1k", BENCH_ITERS, read_data(dentry.inode_index, 0, buf_b, 1024));
+    BENCH("read_data_4k", BENCH_ITERS, read_data(dentry.inode_index, 0, buf_b, 4096));
+    BENCH("read_data_32k", BENCH_ITERS, read_data(dentry.inode_index, 0, buf_b, 32768));
+
+    BENCH("read_dentry_first", BENCH_ITERS, read_dentry_by_name(dechar("."), &dentry));
+    BENCH("read_dentry_long", BENCH_ITERS,
+          read_dentry_by_name(dechar("verylargetextwithverylongname.txt"), &dentry));
+    BENCH("read_dentry_missing", BENCH_ITERS, read_dentry_by_name(dechar("nosuchfile"), &dentry));
+
+    read_dentry_by_name(dechar("fish"), &dentry);
+    size = file_size(dechar("fish"));
+    BENCH("cat_36k_read_write", BENCH_ITERS / 16, cat_read_write(dentry.inode_index, size));
+    BENCH("cat_36k_sendfile", BENCH_ITERS / 16, cat_sendfile(dentry.inode_index, size));
+    BENCH("tail_36k_read", BENCH_ITERS / 16, tail_read(dentry.inode_index, size));
+    BENCH("tail_36k_pread", BENCH_ITERS, tail_pread(dentry.inode_index, size));
+}
+
+/* Memory benchmarks
+ *
+ * The _sse2 variants call the SIMD kernels the kernel's memcpy/memset
+ * switch to at SIMD_MIN_BYTES, with the stores they use at that size
+ * Coverage: memcpy, memset, sse2_memcpy, sse2_memset
+ * Files: lib.c, simd.c
+ */
+static void bench_memory() {
+    BENCH("memcpy_64", BENCH_ITERS, memcpy(buf_b, buf_a, 64));
+    BENCH("memcpy_1k", BENCH_ITERS, memcpy(buf_b, buf_a, 1024));
+    BENCH("memcpy_4k", BENCH_ITERS, memcpy(buf_b, buf_a, 4096));
+    BENCH("memcpy_32k", BENCH_ITERS, memcpy(buf_b, buf_a, 32768));
+    BENCH("memset_64", BENCH_ITERS, memset(buf_b, 0, 64));
+    BENCH("memset_1k", BENCH_ITERS, memset(buf_b, 0, 1024));
+    BENCH("memset_4k", BENCH_ITERS, memset(buf_b, 0, 4096));
+    BENCH("memset_32k", BENCH_ITERS, memset(buf_b, 0, 32768));
+
+#define SSE2_BENCH(name, fn, n, arg)    \
+    BENCH(name, BENCH_ITERS, fn(buf_b, arg, n, (n) >= SIMD_STREAM_BYTES))
+    SSE2_BENCH("memcpy_1k_sse2", sse2_memcpy, 1024, buf_a);
+    SSE2_BENCH("memcpy_4k_sse2", sse2_memcpy, 4096, buf_a);
+    SSE2_BENCH("memcpy_32k_sse2", sse2_memcpy, 32768, buf_a);
+    SSE2_BENCH("memset_1k_sse2", sse2_memset, 1024, 0);
+    SSE2_BENCH("memset_4k_sse2", sse2_memset, 4096, 0);
+    SSE2_BENCH("memset_32k_sse2", sse2_memset, 32768, 0);
+#undef SSE2_BENCH
+}
+
+/* String benchmarks
+ *
+ * Each sample is STRING_REPS calls, so the clock's own cost doesn't swamp
+ * calls this short. The _byte variants run the old byte loops
+ * Coverage: strlen, strncmp, string_length, string_equal, copy_string,
+ *           get_argument
+ * Files: lib.c, utils/char_util.c, utils/arg_util.c
+ */
+#define STRING_REPS     64
+#define REPEAT(body)                                \
+do {                                                \
+    uint32_t rep_;                                  \
+    for (rep_ = 0; rep_ < STRING_REPS; rep_++) {    \
+        body;                                       \
+    }                                               \
+} while (0)
+
+static void bench_strings() {
+    /* Two aligned copies, as dentry names and their lookups mostly are */
+    static int8_t name1[FNAME_MAX_LEN + 4] __attribute__((aligned(4))) = "verylargetextwithverylongname.txt";
+    static int8_t name2[FNAME_MAX_LEN + 4] __attribute__((aligned(4))) = "verylargetextwithverylongname.txt";
+    const int8_t* args = "  grep   verylargetextwithverylongname.txt  ";
+    volatile int32_t sink;
+
+    BENCH("strlen_33", BENCH_ITERS, REPEAT(sink = strlen(name1)));
+    BENCH("strlen_33_byte", BENCH_ITERS, REPEAT(sink = byte_strlen(name1)));
+    BENCH("strncmp_33", BENCH_ITERS, REPEAT(sink = strncmp(name1, name2, FNAME_MAX_LEN)));
+    BENCH("strncmp_33_byte", BENCH_ITERS, REPEAT(sink = byte_strncmp(name1, name2, FNAME_MAX_LEN)));
+    BENCH("string_length_33", BENCH_ITERS, REPEAT(sink = string_length(dechar(name1))));
+    BENCH("string_equal_33", BENCH_ITERS, REPEAT(sink = string_equal(dechar(name1), dechar(name2))));
+    BENCH("string_equal_33_byte", BENCH_ITERS,
+          REPEAT(sink = byte_string_equal(dechar(name1), dechar(name2))));
+    BENCH("copy_string_33", BENCH_ITERS, REPEAT(sink = copy_string(dechar(name1), buf_b)));
+    BENCH("copy_string_33_byte", BENCH_ITERS, REPEAT(sink = byte_copy_string(dechar(name1), buf_b)));
+    BENCH("get_argument", BENCH_ITERS, REPEAT(sink = get_argument(dechar(args), 1, buf_b)));
+    (void)sink;
+}
+
+/* Argument parsing benchmarks
+ *
+ * Splitting a full 127 character command line of 63 words, once with a
+ * get_argument_length/get_argument pair per word as execute used to, once
+ * with parse_arguments
+ * Coverage: parse_arguments, get_argument, get_argument_length
+ * Files: utils/arg_util.c
+ */
+static void bench_arguments() {
+    static int8_t line[MAX_BUFF_LEN];
+    arg_t argv[MAX_ARGS];
+    int32_t argc, i;
+    volatile int32_t sink;
+
+    for (i = 0; i < MAX_BUFF_LEN - 1; i++) line[i] = (i & 1) ? ' ' : 'a' + (i % 26);
+    line[MAX_BUFF_LEN - 1] = '\0';
+    argc = get_argument_count(dechar(line));
+
+    BENCH("split_args_63_rescan", BENCH_ITERS / 16,
+          for (i = 0; i < argc; i++) {
+              sink = get_argument_length(dechar(line), i);
+              sink = get_argument(dechar(line), i, buf_b);
+          });
+    BENCH("split_args_63_once", BENCH_ITERS / 16,
+          sink = parse_arguments(dechar(line), argv, MAX_ARGS));
+    (void)sink;
+}
+
+/* Pipe benchmarks
+ *
+ * A page written into a pipe and read back, which is what a producer and
+ * consumer move per context switch when both keep the pipe busy, and the
+ * same through 1 kB writes and reads as cat does
+ * Coverage: pipe_read, pipe_write
+ * Files: pipe.c
+ */
+static void bench_pipe() {
+    fd_t* fa = get_current_PCB()->file_array;
+    uint32_t i;
+
+    if (pipe_alloc(&fa[2], &fa[3]) != 0) return;
+    BENCH("pipe_4k", BENCH_ITERS,
+          fa[3].fops->write(3, buf_a, PIPE_SIZE);
+          fa[2].fops->read(2, buf_b, PIPE_SIZE));
+    BENCH("pipe_4k_by_1k", BENCH_ITERS,
+          for (i = 0; i < PIPE_SIZE; i += 1024) fa[3].fops->write(3, buf_a, 1024);
+          for (i = 0; i < PIPE_SIZE; i += 1024) fa[2].fops->read(2, buf_b, 1024));
+    fa[2].fops->close(2);
+    fa[3].fops->close(3);
+}
+
+/* hosted_main
+ *
+ * DESCRIPTION: Runs the unit tests, then optionally the benchmarks
+ * INPUTS: fs_addr - loaded file system image
+ *         bench   - nonzero to run the benchmarks
+ * OUTPUTS: number of failed tests
+ */
+int hosted_main(unsigned int fs_addr, int bench) {
+    static char video[VIDEO_PAGE];
+    int32_t failed = 0;
+
+    /* Console output lands in a page of its own; as that isn't the page
+     * the CRTC shows, lib.c never touches the VGA ports */
+    set_video_mem(video);
+    init_filesys(fs_addr);
+
+#define RUN(test)                                   \
+    do {                                            \
+        int32_t result_ = test();                   \
+        TEST_OUTPUT(#test, result_);                \
+        failed += (result_ == FAIL);                \
+    } while (0)
+
+    RUN(char_util_test);
+    RUN(lib_string_test);
+    RUN(lib_memory_test);
+    RUN(word_string_test);
+    RUN(simd_copy_test);
+    RUN(arg_util_test);
+    RUN(parse_arguments_test);
+    RUN(dentry_test);
+    RUN(read_data_test);
+    RUN(data_span_test);
+    RUN(dir_read_test);
+    RUN(stat_test);
+    RUN(seek_test);
+    RUN(pipe_test);
+#undef RUN
+
+    if (bench) {
+        memset(buf_a, 'a', BUF_SIZE);
+        bench_filesys();
+        bench_memory();
+        bench_strings();
+        bench_arguments();
+        bench_pipe();
+        printf("@bench-done\n");
+    }
+
+    return failed;
+}
@@ -26,7 +26,15 @@
 /* local variables */
 uint32_t filesys_addr;    /* Address of filesys in memory            */
 boot_block_t boot_block;  /* Local copy of boot_block from filesys   */
-uint32_t dr_index;        /* Indexing variable of files in filesys   */
+uint32_t dr_index;        /* put_next_dir_name's place in the filesys */
+
+/* Inode metadata, so sizes don't need a walk of the inode blocks */
+typedef struct inode_meta_t {
+    uint32_t length;          /* length in bytes                         */
+    uint32_t blocks;          /* data blocks in use                      */
+} inode_meta_t;
+
+static inode_meta_t inode_meta[MAX_CACHED_INODES];
 
 /*
  * init_filesys
@@ -42,15 +50,75 @@ init_filesys(uint32_t fs_addr)
     filesys_addr = fs_addr;
     boot_block = *((boot_block_t*)filesys_addr);
     dr_index = 0;
+
+    inode_t* inodes = (inode_t*)(filesys_addr + BLOCK_SIZE);
+    uint32_t i;
+    for (i = 0; (i < boot_block.inode_count) && (i < MAX_CACHED_INODES); i++) {
+        inode_meta[i].length = inodes[i].length;
+        inode_meta[i].blocks = (inodes[i].length + BLOCK_SIZE - 1) >> BLOCK_SIZE_LOG_2;
+    }
+}
+
+/*
+ * stat_inode
+ * DESCRIPTION: Describes a regular file's inode from the metadata cache,
+ *              going to the inode itself only past the cached ones
+ * INPUTS: inode_i -- index of the inode
+ *         st      -- where to put the description
+ * OUTPUTS: none
+ * RETURNS: 0 if success, -1 if fail
+ * SIDE EFFECTS: none
+ */
+int32_t
+stat_inode(uint32_t inode_i, stat_t* st)
+{
+    if ((inode_i >= boot_block.inode_count) || (st == NULL)) return -1;
+
+    st->file_type = FILE_TYPE_REGULAR;
+    st->inode_index = inode_i;
+    if (inode_i < MAX_CACHED_INODES) {
+        st->size = inode_meta[inode_i].length;
+        st->blocks = inode_meta[inode_i].blocks;
+    } else {
+        st->size = ((inode_t*)(filesys_addr + BLOCK_SIZE))[inode_i].length;
+        st->blocks = (st->size + BLOCK_SIZE - 1) >> BLOCK_SIZE_LOG_2;
+    }
+    return 0;
+}
+
+/*
+ * stat_dentry
+ * DESCRIPTION: Describes the file behind a dentry. Only regular files
+ *              have a size; the rtc and directory report 0
+ * INPUTS: dentry -- the file's dentry
+ *         st     -- where to put the description
+ * OUTPUTS: none
+ * RETURNS: 0 if success, -1 if fail
+ * SIDE EFFECTS: none
+ */
+int32_t
+stat_dentry(const dentry_t* dentry, stat_t* st)
+{
+    if ((dentry == NULL) || (st == NULL)) return -1;
+
+    if (dentry->file_type == FILE_TYPE_REGULAR) {
+        return stat_inode(dentry->inode_index, st);
+    }
+    st->file_type = dentry->file_type;
+    st->inode_index = dentry->inode_index;
+    st->size = 0;
+    st->blocks = 0;
+    return 0;
 }
 
 /* returns bytes read */
 uint32_t file_size(uint8_t* fname)
 {
 	dentry_t dentry;
+	stat_t st;
 	if (read_dentry_by_name(fname, &dentry) < 0) return -1;
-	inode_t inode = ((inode_t*)(filesys_addr + BLOCK_SIZE))[dentry.inode_index];
-    return inode.length;
+	if (stat_inode(dentry.inode_index, &st) < 0) return -1;
+    return st.size;
 }
 
 
@@ -59,10 +127,10 @@ uint32_t file_size_by_fd(int32_t fd)
 {
     pcb_t* process = get_current_PCB();
     fd_t* file = &process->file_array[(uint32_t)fd];
+    stat_t st;
 
-    inode_t* i = (inode_t*) file->inode;
-    return i->length;
-
+    if (stat_inode(file->inode, &st) < 0) return -1;
+    return st.size;
 }
 
 
@@ -171,32 +239,49 @@ read_data (uint32_t inode_i, uint32_t offset, uint8_t* buffer, uint32_t length)
     if (inode_i < 0 || inode_i >= boot_block.inode_count) return -1;
     if (buffer == NULL) return -1;
 
-    inode_t inode = ((inode_t*)(filesys_addr + BLOCK_SIZE))[inode_i];
-    data_block_t* data_blocks = (data_block_t*)(filesys_addr + BLOCK_SIZE*(1 + boot_block.inode_count));
-    uint32_t byte_count; /* indexing variable */
-
-    /* Not the most efficient way. To avoid this many operations each    */
-    /*   cycle, we can do three separate loops:                          */
-    /*     1. copy bytes until the end of the first data block           */
-    /*     2. copy data from as many data blocks as we have length       */
-    /*        divided by 4096                                            */
-    /*     3. copy data from one more block until we reach length        */
-    /* But we're not doing this... do this for now                       */
-    
-    // global for total bytes, with offset < length both used while ()
-    // 
-    byte_count = 0;
-    for (byte_count = 0; (byte_count < length) && (byte_count + offset < inode.length); byte_count++) {
-        /* Don't *have* to do this every time, so this is lazy way */
-        buffer[byte_count] = data_blocks[inode.data_indices[(byte_count + offset) >> BLOCK_SIZE_LOG_2]]
-                                .data[(byte_count + offset) & BLOCK_MASK];
+    const uint8_t* span;
+    uint32_t byte_count;
+    int32_t n;
+
+    /* A data block at a time, so the cost follows length, not offset */
+    for (byte_count = 0; byte_count < length; byte_count += n) {
+        n = data_span(inode_i, offset + byte_count, &span);
+        if (n <= 0) break;
+        if (n > length - byte_count) n = length - byte_count;
+        memcpy(buffer + byte_count, span, n);
     }
+    return byte_count;
+}
 
-    
+/*
+ * data_span
+ * DESCRIPTION: finds where a file's bytes at offset sit in the image, so
+ *              they can be handed to a device without copying them first
+ * INPUTS: inode_i -- the inode index
+ *         offset  -- the byte offset within the file
+ *         span    -- set to the first byte
+ * OUTPUTS: pointer into the image to span
+ * RETURNS: -1 if failure, otherwise how many bytes follow contiguously,
+ *          up to the end of the data block or of the file; 0 at the end
+ * SIDE EFFECTS: none
+ */
+int32_t
+data_span (uint32_t inode_i, uint32_t offset, const uint8_t** span)
+{
+    if (inode_i >= boot_block.inode_count) return -1;
+    if (span == NULL) return -1;
 
-    // SOMETHING WRONG - FISH // b terminal read
+    inode_t* inode = &((inode_t*)(filesys_addr + BLOCK_SIZE))[inode_i];
+    data_block_t* data_blocks = (data_block_t*)(filesys_addr + BLOCK_SIZE*(1 + boot_block.inode_count));
+    uint32_t length;
 
-    return byte_count;
+    if (offset >= inode->length) return 0;
+
+    length = BLOCK_SIZE - (offset & BLOCK_MASK);
+    if (length > inode->length - offset) length = inode->length - offset;
+
+    *span = data_blocks[inode->data_indices[offset >> BLOCK_SIZE_LOG_2]].data + (offset & BLOCK_MASK);
+    return length;
 }
 
 /*
@@ -229,45 +314,63 @@ put_next_dir_name(uint8_t buf[FNAME_MAX_LEN + 1])
 }
 
 
-/* @TODO:
- * make filesystems great again
- * *** filesystem no longer flat
+/*
  * dir_read
- * DESCRIPTION: Reads the given file in the filesys_img
+ * DESCRIPTION: Reads the next file name of the directory. Each descriptor
+ *              keeps its own place in pos, so listings don't interfere
  * INPUTS: fd       -   file descriptor
  *         buf      -   buffer to read filename to
- *         nbytes   -   number of bytes to read irelevant
+ *         nbytes   -   number of bytes to read, at most FNAME_MAX_LEN
  * OUTPUTS: number of bytes read
- * RETURNS: 1 if success, 0 if end of directory reached.
+ * RETURNS: bytes copied, 0 if end of directory reached (and rewinds).
  *          Should never fail.
- * SIDE EFFECTS:
+ * SIDE EFFECTS: advances the descriptor's pos
  */
 int32_t
 dir_read(int32_t fd, void* buf, int32_t nbytes)
 {
-    //pcb_t* process = get_current_PCB();
-    //fd_t* file = &process->file_array[fd];
-    int32_t data;
+    fd_t* file = &get_current_PCB()->file_array[(uint32_t)fd];
     dentry_t dentry;
-    
-    int read_result = read_dentry_by_index(dr_index++, &dentry);
-    
-   
-    
-    if (read_result < 0) {
+
+    if (read_dentry_by_index(file->pos, &dentry) < 0) {
         /* Reached the end of dentries */
-        dr_index = 0;
+        file->pos = 0;
         return 0;
     }
-    
-    
-    //copy_buf_gradually((uint8_t*)(dentry.name), buf, nbytes);
-    
-    data = copy_buf(dentry.name, buf, nbytes);
+    file->pos++;
+
+    if (nbytes > FNAME_MAX_LEN) nbytes = FNAME_MAX_LEN;
+    copy_buf(dentry.name, buf, nbytes);
     return nbytes;
-    // Flat
-    // get pcb and file from fd
-    //
+}
+
+/*
+ * read_dirents
+ * DESCRIPTION: Fills a batch of directory records, name, type, inode and
+ *              size, starting at a directory cursor
+ * INPUTS: cursor  -- index of the next dentry, advanced past those copied
+ *         dirents -- records to fill
+ *         count   -- room in dirents
+ * OUTPUTS: none
+ * RETURNS: number of records filled, 0 at end of directory, -1 if fail
+ * SIDE EFFECTS: none
+ */
+int32_t
+read_dirents(uint32_t* cursor, dirent_t* dirents, uint32_t count)
+{
+    dentry_t dentry;
+    stat_t st;
+    uint32_t n;
+
+    if ((cursor == NULL) || (dirents == NULL)) return -1;
+
+    for (n = 0; (n < count) && (read_dentry_by_index(*cursor, &dentry) == 0); n++, (*cursor)++) {
+        memcpy(dirents[n].name, dentry.name, FNAME_MAX_LEN);
+        dirents[n].file_type = dentry.file_type;
+        dirents[n].inode_index = dentry.inode_index;
+        dirents[n].size = (stat_dentry(&dentry, &st) == 0) ? st.size : 0;
+    }
+    return n;
 }
 
 // 257, 
@@ -302,6 +405,62 @@ int32_t file_read(int32_t fd, void* buf, int32_t nbytes)
     return data;
 }
 
+/*
+ * file_lseek
+ * DESCRIPTION: Moves the file's position. It may go past the end, where
+ *              reads return 0
+ * INPUTS:  fd     -   File Descriptor
+ *          offset -   bytes to move, relative to whence
+ *          whence -   SEEK_SET, SEEK_CUR or SEEK_END
+ * OUTPUTS: none
+ * RETURNS: the new position, -1 if whence is bad or it would be negative
+ * SIDE EFFECTS: sets the descriptor's pos
+ */
+int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+    fd_t* file = &get_current_PCB()->file_array[(uint32_t)fd];
+    stat_t st;
+    int32_t base;
+
+    switch (whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = file->pos;
+            break;
+        case SEEK_END:
+            if (stat_inode(file->inode, &st) < 0) return -1;
+            base = st.size;
+            break;
+        default:
+            return -1;
+    }
+
+    if ((offset < -base) || (offset > POS_MAX - base)) return -1;
+    file->pos = base + offset;
+    return file->pos;
+}
+
+/*
+ * file_pread
+ * DESCRIPTION: Reads at a given offset, leaving the file's position alone
+ * INPUTS:  fd     -   File Descriptor
+ *          buf    -   buffer in which to put the data
+ *          nbytes -   number of bytes to read
+ *          offset -   byte offset within the file
+ * OUTPUTS: file data to buf
+ * RETURNS: bytes read, 0 at or past the end, -1 if fail
+ * SIDE EFFECTS: none
+ */
+int32_t file_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset)
+{
+    fd_t* file = &get_current_PCB()->file_array[(uint32_t)fd];
+
+    if (nbytes < 0) return -1;
+    return read_data(file->inode, offset, buf, nbytes);
+}
+
 /*
  * file_write
  * DESCRIPTION: writes to given file
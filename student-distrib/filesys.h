@@ -8,6 +8,16 @@
 #define FNAME_MAX_LEN 32
 #define DENTRY_COUNT 63
 
+/* dentry_t file_type values */
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_REGULAR 2
+/* fstat/stat type of the terminal, pipes and named devices */
+#define FILE_TYPE_DEVICE 3
+
+/* Inodes whose metadata init_filesys caches; the image has 64 */
+#define MAX_CACHED_INODES 64
+
 typedef struct dentry_t {
     union {
         uint32_t val[16];
@@ -43,6 +53,22 @@ typedef struct boot_block_t {
     };
 } boot_block_t;
 
+/* A directory entry as getdents hands it out */
+typedef struct dirent_t {
+    uint8_t name[FNAME_MAX_LEN];  /* not terminated if 32 long   */
+    uint32_t file_type;           /* file type (0, 1, or 2)      */
+    uint32_t inode_index;         /* index of associated inode   */
+    uint32_t size;                /* length in bytes, 0 unless 2 */
+} dirent_t;
+
+/* What stat and fstat report */
+typedef struct stat_t {
+    uint32_t file_type;           /* FILE_TYPE_*                 */
+    uint32_t inode_index;         /* index of associated inode   */
+    uint32_t size;                /* length in bytes             */
+    uint32_t blocks;              /* data blocks holding it      */
+} stat_t;
+
 typedef struct data_block_t {
     uint8_t data[BLOCK_SIZE];
 } data_block_t;
@@ -58,11 +84,19 @@ int32_t read_dentry_by_index (uint32_t index, dentry_t* dentry);
 int32_t read_file_bytes_by_name(uint8_t* fname, uint8_t* buf, uint32_t length);
 /* Puts byte data from file into buffer based on inode and offset */
 int32_t read_data (uint32_t inode_i, uint32_t offset, uint8_t* buffer, uint32_t length);
+/* Points at a file's bytes in place, returning how many are contiguous */
+int32_t data_span (uint32_t inode_i, uint32_t offset, const uint8_t** span);
 
 /* Returns the next file name in the filesys */
 uint32_t put_next_dir_name(uint8_t buf[FNAME_MAX_LEN + 1]);
 /* reads directory given */
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes);
+/* Fills dirents with up to count entries from *cursor on, advancing it */
+int32_t read_dirents(uint32_t* cursor, dirent_t* dirents, uint32_t count);
+/* Fills st for a dentry, from the inode metadata cache */
+int32_t stat_dentry(const dentry_t* dentry, stat_t* st);
+/* Fills st for a regular file's inode */
+int32_t stat_inode(uint32_t inode_i, stat_t* st);
 /* returnrs file size */
 uint32_t file_size(uint8_t* fname);
 /* returns file size by fd */
@@ -73,6 +107,10 @@ uint32_t file_size_by_fd(int32_t fd);
 int32_t file_read(int32_t fd, void* buf, int32_t nbytes);
 /*  */
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes);
+/* Repositions the file, as lseek */
+int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence);
+/* Reads at an offset without moving the position, as pread */
+int32_t file_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
 /*  */
 int32_t file_open(const uint8_t* filename);
 /*  */
@@ -0,0 +1,232 @@
+/* fpu.c - CPU feature detection and kernel FPU sections
+ * vim:ts=4 noexpandtab
+ */
+
+#include "fpu.h"
+#include "lib.h"
+#include "sched.h"
+#include "syscalls.h"
+
+#define EFLAGS_ID           (1 << 21)
+#define CR0_MP              (1 << 1)
+#define CR0_EM              (1 << 2)
+#define CR0_TS              (1 << 3)
+#define CR4_OSFXSR          (1 << 9)
+#define CR4_OSXMMEXCPT      (1 << 10)
+
+#define XMM_SAVED           4       /* xmm0-xmm3 */
+#define XMM_SIZE            16
+
+
+uint32_t simd_enabled;
+
+/* Process whose registers are in the FPU, -1 if nobody's are */
+static int32_t fpu_owner = -1;
+/* State right after fninit, given to a process on its first FPU use so it
+ * never sees what an earlier process left in the registers */
+static uint8_t fpu_clean[FXSAVE_SIZE] __attribute__((aligned(FXSAVE_ALIGN)));
+
+/* xmm registers of the owner when the kernel borrowed them. Interrupts
+ * are off for the whole section, so one area is enough */
+static uint8_t xmm_save[XMM_SAVED * XMM_SIZE] __attribute__((aligned(XMM_SIZE)));
+static uint32_t fpu_flags;
+static uint32_t fpu_saved_xmm;
+static uint32_t fpu_was_ts;
+
+/* Sets CR0.TS, so the next FPU instruction faults with #NM */
+static inline void stts(void) {
+    uint32_t cr0;
+
+    asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+    asm volatile ("movl %0, %%cr0" : : "r"(cr0 | CR0_TS));
+}
+
+/* Clears CR0.TS */
+static inline void clts(void) {
+    asm volatile ("clts");
+}
+
+/* cpuid_edx
+ *
+ * DESCRIPTION: Reads the feature flags of CPUID leaf 1. CPUs without CPUID
+ *              can't toggle EFLAGS.ID and report no features
+ * INPUTS: None
+ * OUTPUTS: CPUID.1:EDX, or 0
+ */
+static uint32_t cpuid_edx(void) {
+    uint32_t before, after, eax, ebx, ecx, edx;
+
+    asm volatile ("                 \n\
+            pushfl                  \n\
+            popl    %0              \n\
+            movl    %0, %1          \n\
+            xorl    %2, %1          \n\
+            pushl   %1              \n\
+            popfl                   \n\
+            pushfl                  \n\
+            popl    %1              \n\
+            pushl   %0              \n\
+            popfl                   \n\
+            "
+            : "=&r"(before), "=&r"(after)
+            : "i"(EFLAGS_ID)
+            : "cc"
+    );
+    if (((before ^ after) & EFLAGS_ID) == 0) return 0;
+
+    asm volatile ("cpuid"
+            : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+            : "a"(1)
+    );
+    return edx;
+}
+
+/* fpu_init
+ *
+ * DESCRIPTION: Turns on SSE when the CPU has SSE2 and fxsave: the x87 is
+ *              made native (CR0.EM off, CR0.MP on) and CR4 tells the CPU
+ *              the kernel knows about the SSE state
+ * INPUTS: None
+ * OUTPUTS: None
+ * SIDE EFFECTS: Sets simd_enabled, after which memcpy/memset use SSE2
+ */
+void fpu_init(void) {
+    uint32_t edx = cpuid_edx();
+    uint32_t needed = CPUID_FXSR | CPUID_SSE | CPUID_SSE2;
+    uint32_t cr;
+
+    if ((edx & needed) != needed) {
+        printf("fpu: no SSE2, using rep movs copies\n");
+        return;
+    }
+
+    asm volatile ("movl %%cr0, %0" : "=r"(cr));
+    cr = (cr & ~CR0_EM) | CR0_MP;
+    asm volatile ("movl %0, %%cr0" : : "r"(cr));
+    asm volatile ("movl %%cr4, %0" : "=r"(cr));
+    cr |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile ("movl %0, %%cr4" : : "r"(cr));
+    asm volatile ("fninit");
+    asm volatile ("fxsave (%0)" : : "r"(fpu_clean) : "memory");
+
+    simd_enabled = 1;
+    /* Nobody owns the FPU yet */
+    stts();
+}
+
+/* kernel_fpu_begin
+ *
+ * DESCRIPTION: Lets the kernel use xmm0-xmm3. They only hold something
+ *              worth keeping if a process owns the FPU, and then only
+ *              those four are saved, which costs far less than an fxsave.
+ *              CR0.TS is cleared for the section so the kernel's own SSE
+ *              doesn't fault. Interrupts are disabled so no handler can
+ *              start a section of its own over this one
+ * INPUTS: None
+ * OUTPUTS: None
+ */
+void kernel_fpu_begin(void) {
+    uint32_t flags, cr0;
+
+    cli_and_save(flags);
+    fpu_flags = flags;
+
+    asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+    fpu_was_ts = cr0 & CR0_TS;
+    if (fpu_was_ts) clts();
+
+    fpu_saved_xmm = (fpu_owner >= 0);
+    if (!fpu_saved_xmm) return;
+    asm volatile ("                 \n\
+            movdqa  %%xmm0, (%0)    \n\
+            movdqa  %%xmm1, 16(%0)  \n\
+            movdqa  %%xmm2, 32(%0)  \n\
+            movdqa  %%xmm3, 48(%0)  \n\
+            "
+            :
+            : "r"(xmm_save)
+            : "memory"
+    );
+}
+
+/* kernel_fpu_end
+ *
+ * DESCRIPTION: Gives xmm0-xmm3 back, and CR0.TS and the interrupt flag
+ * INPUTS: None
+ * OUTPUTS: None
+ */
+void kernel_fpu_end(void) {
+    if (fpu_saved_xmm) {
+        asm volatile ("                 \n\
+                movdqa  (%0), %%xmm0    \n\
+                movdqa  16(%0), %%xmm1  \n\
+                movdqa  32(%0), %%xmm2  \n\
+                movdqa  48(%0), %%xmm3  \n\
+                "
+                :
+                : "r"(xmm_save)
+                : "memory"
+        );
+    }
+    if (fpu_was_ts) stts();
+    restore_flags(fpu_flags);
+}
+
+/* fpu_nm_handler
+ *
+ * DESCRIPTION: #NM handler, entered through nm_intr when a process uses
+ *              the FPU with CR0.TS set. The owner's registers are saved to
+ *              its PCB and the current process' loaded (or the clean state
+ *              on its first use); the faulting instruction then reruns
+ * INPUTS: None
+ * OUTPUTS: None
+ * SIDE EFFECTS: Clears CR0.TS and makes the current process the owner
+ */
+void fpu_nm_handler(void) {
+    int32_t pid = running_procs[running_terminal];
+    pcb_t* pcb;
+
+    if (!simd_enabled || pid < 0) {
+        printf("EXCEPTION7: Device Not Available");
+        while(1);
+    }
+
+    clts();
+    if (fpu_owner == pid) return;
+
+    if (fpu_owner >= 0) {
+        asm volatile ("fxsave (%0)" : : "r"(find_PCB(fpu_owner)->fpu_state) : "memory");
+    }
+
+    pcb = find_PCB(pid);
+    asm volatile ("fxrstor (%0)"
+            :
+            : "r"(pcb->fpu_used ? pcb->fpu_state : fpu_clean)
+            : "memory"
+    );
+    pcb->fpu_used = 1;
+    fpu_owner = pid;
+}
+
+/* fpu_switch
+ *
+ * DESCRIPTION: Arms the #NM fault for the process about to run. Its
+ *              registers are only swapped in if it actually uses the FPU
+ * INPUTS: None
+ * OUTPUTS: None
+ */
+void fpu_switch(void) {
+    if (simd_enabled) stts();
+}
+
+/* fpu_exit
+ *
+ * DESCRIPTION: Forgets a process' FPU state when it halts, so nothing is
+ *              saved on its behalf later
+ * INPUTS: pid - process going away
+ * OUTPUTS: None
+ */
+void fpu_exit(int32_t pid) {
+    if (fpu_owner == pid) fpu_owner = -1;
+    fpu_switch();
+}
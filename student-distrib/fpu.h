@@ -0,0 +1,35 @@
+/* fpu.h - CPU feature detection and kernel FPU sections
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _FPU_H
+#define _FPU_H
+#include "types.h"
+
+/* CPUID leaf 1 EDX feature bits */
+#define CPUID_FXSR          (1 << 24)
+#define CPUID_SSE           (1 << 25)
+#define CPUID_SSE2          (1 << 26)
+
+/* Size of an fxsave/fxrstor image, which must be 16-byte aligned */
+#define FXSAVE_SIZE         512
+#define FXSAVE_ALIGN        16
+
+/* Nonzero once fpu_init has found SSE2 and turned it on */
+extern uint32_t simd_enabled;
+
+/* Detect the CPU's SIMD support and enable it */
+void fpu_init(void);
+
+/* Bracket kernel use of xmm0-xmm3; interrupts stay off in between */
+void kernel_fpu_begin(void);
+void kernel_fpu_end(void);
+
+/* Lazy FPU switching: a process gets the FPU registers on its first FPU
+ * or SSE instruction after a switch, through the #NM (vector 7) fault */
+void fpu_nm_handler(void);
+/* Call when another process starts running */
+void fpu_switch(void);
+/* Call when a process goes away; its register contents are dropped */
+void fpu_exit(int32_t pid);
+
+#endif /* _FPU_H */
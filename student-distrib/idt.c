@@ -3,6 +3,7 @@
 #include "idt.h"
 #include "x86_desc.h"
 #include "lib.h"
+#include "trace.h"
 
 #define UPPER_MASK   0xffff0000 // selects upper memeory bits
 #define SYS_CALL     0x80
@@ -25,6 +26,7 @@ extern void irq13();
 extern void irq14();
 extern void irq15();
 extern void sys_call();
+extern void nm_intr();
 
 void setup_idt_exceptions();
 void setup_idt_exceptions();
@@ -39,7 +41,6 @@ void excpt3_handler();
 void excpt4_handler();
 void excpt5_handler();
 void excpt6_handler();
-void excpt7_handler();
 void excpt8_handler();
 void excpt9_handler();
 void excpt10_handler();
@@ -197,7 +198,7 @@ void setup_idt_exceptions()
     SET_IDT_ENTRY(idt[4], excpt4_handler);          // Overflow
     SET_IDT_ENTRY(idt[5], excpt5_handler);          // BOUND Range Exceeded
     SET_IDT_ENTRY(idt[6], excpt6_handler);          // Invalid Opcode
-    SET_IDT_ENTRY(idt[7], excpt7_handler);          // Device Not Available
+    SET_IDT_ENTRY(idt[7], nm_intr);                 // Device Not Available, lazy FPU
     SET_IDT_ENTRY(idt[8], excpt8_handler);          // Double Fault
     SET_IDT_ENTRY(idt[9], excpt9_handler);          // Coprocessor Segment Overrun
     SET_IDT_ENTRY(idt[10], excpt10_handler);        // Invalid TSS
@@ -314,13 +315,6 @@ void excpt6_handler()
     while(1);
 }
 
-void excpt7_handler()
-{
-
-    printf("EXCEPTION7: Device Not Available");
-    while(1);
-}
-
 void excpt8_handler()
 {
 
@@ -365,6 +359,12 @@ void excpt13_handler()
 
 void excpt14_handler()
 {
+    uint32_t cr2;
+
+    asm volatile ("movl %%cr2, %0" : "=r" (cr2));
+    TRACE(TRACE_PAGE_FAULT, cr2);
+    /* Nothing comes back from here; get the trace out first */
+    trace_flush();
 
     printf("EXCEPTION14: Page Fault\n");
     while(1);
@@ -9,6 +9,7 @@
 #include "debug.h"
 #include "tests.h"
 #include "paging.h"
+#include "fpu.h"
 #include "idt.h"
 #include "rtc.h"
 #include "terminal.h"
@@ -16,6 +17,9 @@
 #include "sched.h"
 #include "syscalls.h"
 #include "pit.h"
+#include "softirq.h"
+#include "serial.h"
+#include "trace.h"
 
 #include "utils/char_util.h"
 
@@ -154,9 +158,16 @@ void entry(unsigned long magic, unsigned long addr) {
 
     init_paging();
 
+    /* Turn on SSE for memcpy/memset if the CPU has it */
+    fpu_init();
+
     // initialize IDT
     init_idt();
 
+    /* Initialize serial port; printf is mirrored to it from here on */
+    serial_init();
+    trace_init();
+
     /* Initialize clock */
     rtc_init();
     // rtc_open(NULL);
@@ -184,6 +195,10 @@ void entry(unsigned long magic, unsigned long addr) {
 #endif
     /* Execute the first program ("shell") ... */
     if (!USING_PIT) execute(dechar("shell"));
-    /* Spin (nicely, so we don't chew up cycles) */
-    asm volatile (".1: hlt; jmp .1;");
+    /* Spin (nicely, so we don't chew up cycles), picking up deferred work
+     * such as the first reschedule since interrupts here return to the kernel */
+    while (1) {
+        asm volatile ("sti; hlt");
+        do_softirq();
+    }
 }
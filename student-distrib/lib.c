@@ -3,16 +3,50 @@
 
 #include "lib.h"
 #include "terminal.h"
+#include "scrollback.h"
+#include "serial.h"
+#include "fpu.h"
+#include "simd.h"
 
 #define VGA1 0x3D4
 #define VGA2 0x3D5
 
 #define MAX_BUFF_LENGTH 128
 
+#define ROW_BYTES   (NUM_COLS * 2)
+
+/* VGA CRTC registers, written through VGA1/VGA2 */
+#define CRTC_START_HIGH  0x0C
+#define CRTC_START_LOW   0x0D
+#define CRTC_CURSOR_HIGH 0x0E
+#define CRTC_CURSOR_LOW  0x0F
+
 static int screen_x;
 static int screen_y;
 static char* video_mem = (char *)VIDEO;
 
+/* Page of VGA memory the CRTC is showing, and its offset in cells */
+static char* display_mem = (char *)VIDEO;
+static uint32_t display_base;
+
+/* Each terminal's text as a circular array of rows; text_head is the ring
+ * row shown at the top of the screen, so scrolling only moves the head */
+static uint16_t text_lines[MAX_TERMINAL_NUM][NUM_ROWS][NUM_COLS];
+static uint32_t text_head[MAX_TERMINAL_NUM];
+/* How many lines each terminal is scrolled back into its history, 0 = live */
+static int32_t text_view[MAX_TERMINAL_NUM];
+
+static void set_hw_cursor(int x, int y);
+static int32_t new_line(uint32_t term);
+static uint32_t text_term(void);
+static uint16_t* text_row(uint32_t term, int32_t y);
+static void ring_scroll(uint32_t term);
+static void blit_rows(uint32_t term, int32_t first, int32_t count);
+static void view_live(uint32_t term);
+/* Their asm has fixed labels, so they must not be inlined twice */
+static void* rep_memset(void* s, int32_t c, uint32_t n) __attribute__((noinline));
+static void* rep_memcpy(void* dest, const void* src, uint32_t n) __attribute__((noinline));
+
 /* get_video_mem
  * getter for the video_mem location
  */
@@ -32,11 +66,8 @@ void set_video_mem(char* new_mem) {
  * Return Value: none
  * Function: Clears video memory */
 void clear(void) {
-    int32_t i;
-    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
-    }
+    clear_text(text_term());
+    memset_word(video_mem, BLANK_CELL, NUM_ROWS * NUM_COLS);
     screen_x = 0;
     screen_y = 0;
 
@@ -44,24 +75,74 @@ void clear(void) {
 
 }
 
+/* clear_text
+ *
+ * DESCRIPTION: Blanks a terminal's line ring and shows it live. The screen
+ *              itself is left alone
+ *
+ * INPUTS: term -- terminal index
+ * OUTPUTS: none
+ */
+void clear_text(uint32_t term) {
+    memset_word(text_lines[term], BLANK_CELL, NUM_ROWS * NUM_COLS);
+    text_head[term] = 0;
+    text_view[term] = 0;
+}
+
 /* update_cursor
  *
  * DESCRIPTION: Updates location of the cursor
  *
  * INPUTS: x, y
  * OUTPUTS
- * SIDE EFFECTS: Polls location of cursor then updates
+ * SIDE EFFECTS: Moves the hardware cursor, but only when the text being
+ *               written is on the displayed page
  */
 void update_cursor(int x, int y){
+  if(video_mem != display_mem){
+    return;
+  }
+  set_hw_cursor(x, y);
+}
 
- int32_t position = (y * NUM_COLS) + x;
+/* show_video_page
+ *
+ * DESCRIPTION: Page-flips the screen to another page of VGA text memory
+ *
+ * INPUTS: page -- start of the page inside the VGA text window
+ *         x, y -- cursor position on that page
+ * OUTPUTS: none
+ * SIDE EFFECTS: Reprograms the CRTC start address and the cursor
+ */
+void show_video_page(char* page, int x, int y){
+  display_mem = page;
+  display_base = (page - (char *)VIDEO) >> 1;
+
+  outb(CRTC_START_HIGH, VGA1);
+  outb((unsigned char)((display_base >> 8) & 0xFF), VGA2);
+  outb(CRTC_START_LOW, VGA1);
+  outb((unsigned char)(display_base & 0xFF), VGA2);
+
+  set_hw_cursor(x, y);
+}
+
+/* set_hw_cursor
+ *
+ * DESCRIPTION: Programs the cursor position, relative to the displayed page
+ *
+ * INPUTS: x, y
+ * OUTPUTS: none
+ */
+static void set_hw_cursor(int x, int y){
+
+ int32_t position = display_base + (y * NUM_COLS) + x;
 
   /* cursor low port to VGA index reg */
-  outb(0x0F, VGA1);
+  outb(CRTC_CURSOR_LOW, VGA1);
   outb((unsigned char)(position & 0xFF), VGA2);
 
   /* cursor high port to VGA index reg */
-  outb(0x0E, VGA1);
+  outb(CRTC_CURSOR_HIGH, VGA1);
   outb((unsigned char)((position >> 8) & 0xFF), VGA2);
 }
 
@@ -91,6 +172,8 @@ void wrap_around(void)
  * SIDE EFFECTS: handle backspace
  */
 void print_backspace(){
+  view_live(text_term());
+
   if(screen_x == 0 && screen_y == 0){
       /* do nothing */
   }
@@ -114,7 +197,8 @@ void print_backspace(){
   }
 
 
-  *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = ' ';
+  text_row(text_term(), screen_y)[screen_x] = BLANK_CELL;
+  ((uint16_t*)video_mem)[NUM_COLS * screen_y + screen_x] = BLANK_CELL;
 
   update_cursor(screen_x, screen_y);
 }
@@ -299,6 +383,10 @@ int32_t puts(int8_t* s) {
  * Return Value: void
  *  Function: Output a character to the console */
 void putc(uint8_t c) {
+    if (SERIAL_LOG || running_terminal == SERIAL_TERMINAL) serial_putc(c);
+    if (running_terminal == SERIAL_TERMINAL) return;
+    view_live(text_term());
+
     if(c == '\n' || c == '\r') {
         screen_y++;
         screen_x = 0;
@@ -313,8 +401,9 @@ void putc(uint8_t c) {
     } else {
         if(get_key_index() < MAX_BUFF_LENGTH)
         {
-          *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = c;
-          *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
+          uint16_t cell = (ATTRIB << 8) | c;
+          text_row(text_term(), screen_y)[screen_x] = cell;
+          ((uint16_t*)video_mem)[NUM_COLS * screen_y + screen_x] = cell;
           screen_x++;
           screen_x %= NUM_COLS;
           screen_y = (screen_y + (screen_x / NUM_COLS)) % NUM_ROWS;
@@ -322,6 +411,85 @@ void putc(uint8_t c) {
     }
 }
 
+/* int32_t write_text(const uint8_t* buf, int32_t n);
+ * Inputs: const uint8_t* buf = characters to print
+ *                  int32_t n = number of bytes in buf
+ * Return Value: Number of characters printed (NUL bytes are skipped)
+ * Function: Bulk version of putc. Runs of characters are stored as whole
+ *           cells into the terminal's line ring only; scrolls just advance
+ *           the ring head. The touched rows (or the whole screen, if it
+ *           scrolled) are then copied to video memory in one go and the
+ *           hardware cursor is moved once at the end */
+int32_t write_text(const uint8_t* buf, int32_t n) {
+    uint32_t term = text_term();
+    uint16_t* cell;
+    int32_t i, run, count, first_row, scrolled;
+    uint8_t c;
+
+    count = 0;
+    first_row = screen_y;
+
+    /* Output snaps a scrolled-back view back to live, redrawn below */
+    scrolled = (text_view[term] != 0);
+    text_view[term] = 0;
+    i = 0;
+    while (i < n) {
+        c = buf[i];
+        if (c == '\0') {
+            i++;
+            continue;
+        }
+        if (c == '\n' || c == '\r') {
+            scrolled |= new_line(term);
+            count++;
+            i++;
+            continue;
+        }
+
+        /* Copy the run that fits on this line */
+        cell = text_row(term, screen_y) + screen_x;
+        for (run = 0; i < n && screen_x + run < NUM_COLS; i++) {
+            c = buf[i];
+            if (c == '\n' || c == '\r') break;
+            if (c == '\0') continue;
+            cell[run++] = (ATTRIB << 8) | c;
+        }
+        screen_x += run;
+        count += run;
+
+        if (screen_x == NUM_COLS) scrolled |= new_line(term);
+    }
+
+    /* Push the whole batch to the screen */
+    if (scrolled) {
+        blit_rows(term, 0, NUM_ROWS);
+    } else {
+        blit_rows(term, first_row, screen_y - first_row + 1);
+    }
+
+    update_cursor(screen_x, screen_y);
+    return count;
+}
+
+/* new_line
+ *
+ * DESCRIPTION: Moves to the start of the next line, scrolling the line ring
+ *              if needed. Touches neither video memory nor the cursor
+ *
+ * INPUT: term -- terminal whose line ring to use
+ * OUTPUT: 1 if the ring scrolled, 0 otherwise
+ */
+static int32_t new_line(uint32_t term) {
+    screen_x = 0;
+    screen_y++;
+    if (screen_y == NUM_ROWS) {
+        ring_scroll(term);
+        screen_y--;
+        return 1;
+    }
+    return 0;
+}
+
 /* scroll_handle
  *
  * DESCRIPTION: Handles terminal when text reaches bottom of screen
@@ -330,21 +498,11 @@ void putc(uint8_t c) {
  * SIDE EFFECTS: Scrolls terminal
  */
 void scroll_handle(void){
-  int32_t x, y;
-
-  /* Shift memory up 1 row */
- for(y = 0; y < NUM_ROWS - 1; y++){
-     for(x = 0; x < NUM_COLS; x++){
-        *(uint8_t *)(video_mem + ((NUM_COLS * y + x) << 1)) = *(uint8_t *)(video_mem + (((NUM_COLS * (y+1) + x)) << 1));
-        *(uint8_t *)(video_mem + ((NUM_COLS * y + x) << 1) + 1) = ATTRIB;
-     }
- }
-
-  /* Change last row to all ' ' */
-  for(x = 0; x < NUM_COLS; x++){
-    *(uint8_t *)(video_mem + ((NUM_COLS * (NUM_ROWS-1) + x) << 1)) = ' ';
-    *(uint8_t *)(video_mem + ((NUM_COLS * (NUM_ROWS-1) + x) << 1)+1) = ATTRIB;
-  }
+  uint32_t term = text_term();
+
+  text_view[term] = 0;
+  ring_scroll(term);
+  blit_rows(term, 0, NUM_ROWS);
 
   /* Update variable and cursor */
   screen_y--;
@@ -352,6 +510,127 @@ void scroll_handle(void){
   update_cursor(0, screen_y);
 }
 
+/* text_term
+ *
+ * DESCRIPTION: Terminal whose text video_mem currently shows
+ *
+ * OUTPUT: terminal index, 0 before the scheduler picks one
+ */
+static uint32_t text_term(void) {
+    return (running_terminal < MAX_TERMINAL_NUM) ? running_terminal : 0;
+}
+
+/* text_row
+ *
+ * DESCRIPTION: Finds a screen row inside a terminal's line ring
+ *
+ * INPUT: term -- terminal index
+ *        y    -- screen row, 0 is the top of the screen
+ * OUTPUT: pointer to the row's first cell
+ */
+static uint16_t* text_row(uint32_t term, int32_t y) {
+    return text_lines[term][(text_head[term] + y) % NUM_ROWS];
+}
+
+/* ring_scroll
+ *
+ * DESCRIPTION: Scrolls a line ring by one row. The old top row is saved to
+ *              the scrollback and reused, blanked, as the new bottom row,
+ *              so nothing on screen is moved
+ *
+ * INPUT: term -- terminal index
+ */
+static void ring_scroll(uint32_t term) {
+    uint16_t* row = text_lines[term][text_head[term]];
+
+    scrollback_push(term, row);
+    text_head[term] = (text_head[term] + 1) % NUM_ROWS;
+    memset_word(row, BLANK_CELL, NUM_COLS);
+}
+
+/* blit_rows
+ *
+ * DESCRIPTION: Copies screen rows from a line ring to video memory. The
+ *              rows are contiguous in the ring except where it wraps, so
+ *              this is at most two memcpys
+ *
+ * INPUT: term  -- terminal index
+ *        first -- first screen row to copy
+ *        count -- number of rows
+ */
+static void blit_rows(uint32_t term, int32_t first, int32_t count) {
+    int32_t ring_row = (text_head[term] + first) % NUM_ROWS;
+    int32_t chunk = NUM_ROWS - ring_row;
+
+    if (count <= 0) return;
+    if (chunk > count) chunk = count;
+
+    memcpy(video_mem + first * ROW_BYTES, text_lines[term][ring_row], chunk * ROW_BYTES);
+    if (count > chunk) {
+        memcpy(video_mem + (first + chunk) * ROW_BYTES, text_lines[term][0], (count - chunk) * ROW_BYTES);
+    }
+}
+
+/* scroll_view
+ *
+ * DESCRIPTION: Scrolls the running terminal's view through its history and
+ *              redraws it. Only the NUM_ROWS visible lines are rendered
+ *
+ * INPUT: lines -- how many lines further back to look, negative to go
+ *                 towards the live screen
+ * SIDE EFFECTS: Any later output returns the view to live
+ */
+void scroll_view(int32_t lines) {
+    uint32_t term = text_term();
+    int32_t view = text_view[term] + lines;
+    int32_t y;
+
+    if (view < 0) view = 0;
+    if (view > (int32_t)scrollback_count(term)) view = scrollback_count(term);
+    if (view == text_view[term]) return;
+    text_view[term] = view;
+
+    for (y = 0; y < NUM_ROWS; y++) {
+        if (y < view) {
+            scrollback_line(term, view - y, (uint16_t*)video_mem + NUM_COLS * y);
+        } else {
+            memcpy(video_mem + y * ROW_BYTES, text_row(term, y - view), ROW_BYTES);
+        }
+    }
+}
+
+/* view_live
+ *
+ * DESCRIPTION: Returns a scrolled-back terminal to its live screen
+ *
+ * INPUT: term -- terminal index
+ */
+static void view_live(uint32_t term) {
+    if (text_view[term] == 0) return;
+    text_view[term] = 0;
+    blit_rows(term, 0, NUM_ROWS);
+}
+
+/* uint64_t udiv64(uint64_t n, uint32_t d);
+ * Inputs: uint64_t n = dividend
+ *         uint32_t d = divisor, must not be zero
+ * Return Value: n / d
+ * Function: Long division in two 32-bit steps using divl, since the kernel
+ *           is not linked against libgcc's __udivdi3 */
+uint64_t udiv64(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t q_lo;
+
+    hi %= d;
+    asm volatile ("divl %2"
+            : "=a"(q_lo), "=d"(hi)
+            : "rm"(d), "a"(lo), "d"(hi)
+            : "cc"
+    );
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
  * Inputs: uint32_t value = number to convert
@@ -413,12 +692,19 @@ int8_t* strrev(int8_t* s) {
 /* uint32_t strlen(const int8_t* s);
  * Inputs: const int8_t* s = string to take length of
  * Return Value: length of string s
- * Function: return length of string s */
+ * Function: return length of string s. Scans a word at a time once s is
+ *           aligned; aligned loads never cross a page, so reading past the
+ *           terminator inside its word is safe */
 uint32_t strlen(const int8_t* s) {
-    register uint32_t len = 0;
-    while (s[len] != '\0')
-        len++;
-    return len;
+    const int8_t* p = s;
+    const uint32_t* w;
+
+    for (; !WORD_ALIGNED(p); p++) {
+        if (*p == '\0') return p - s;
+    }
+    for (w = (const uint32_t*)p; !HAS_ZERO_BYTE(*w); w++);
+    for (p = (const int8_t*)w; *p != '\0'; p++);
+    return p - s;
 }
 
 /* void* memset(void* s, int32_t c, uint32_t n);
@@ -426,8 +712,30 @@ uint32_t strlen(const int8_t* s) {
  *          int32_t c = value to set memory to
  *         uint32_t n = number of bytes to set
  * Return Value: new string
- * Function: set n consecutive bytes of pointer s to value c */
+ * Function: set n consecutive bytes of pointer s to value c. Large fills
+ *           align s, then go through the SSE2 kernel when it's enabled */
 void* memset(void* s, int32_t c, uint32_t n) {
+    uint32_t head, body;
+
+    if (!simd_enabled || n < SIMD_MIN_BYTES) return rep_memset(s, c, n);
+
+    head = -(uint32_t)s & SIMD_ALIGN_MASK;
+    body = (n - head) & ~SIMD_BLOCK_MASK;
+    rep_memset(s, c, head);
+    kernel_fpu_begin();
+    sse2_memset((uint8_t*)s + head, c, body, n >= SIMD_STREAM_BYTES);
+    kernel_fpu_end();
+    rep_memset((uint8_t*)s + head + body, c, n - head - body);
+    return s;
+}
+
+/* void* rep_memset(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: memset with rep stosl between byte loops */
+static void* rep_memset(void* s, int32_t c, uint32_t n) {
     c &= 0xFF;
     asm volatile ("                 \n\
             .memset_top:            \n\
@@ -509,8 +817,30 @@ void* memset_dword(void* s, int32_t c, uint32_t n) {
  *         const void* src = source of copy
  *              uint32_t n = number of byets to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of src to dest */
+ * Function: copy n bytes of src to dest. Large copies align dest, then go
+ *           through the SSE2 kernel when it's enabled */
 void* memcpy(void* dest, const void* src, uint32_t n) {
+    uint32_t head, body;
+
+    if (!simd_enabled || n < SIMD_MIN_BYTES) return rep_memcpy(dest, src, n);
+
+    head = -(uint32_t)dest & SIMD_ALIGN_MASK;
+    body = (n - head) & ~SIMD_BLOCK_MASK;
+    rep_memcpy(dest, src, head);
+    kernel_fpu_begin();
+    sse2_memcpy((uint8_t*)dest + head, (const uint8_t*)src + head, body, n >= SIMD_STREAM_BYTES);
+    kernel_fpu_end();
+    rep_memcpy((uint8_t*)dest + head + body, (const uint8_t*)src + head + body, n - head - body);
+    return dest;
+}
+
+/* void* rep_memcpy(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: memcpy with rep movsl between byte loops */
+static void* rep_memcpy(void* dest, const void* src, uint32_t n) {
     asm volatile ("                 \n\
             .memcpy_top:            \n\
             testl   %%ecx, %%ecx    \n\
@@ -589,6 +919,20 @@ void* memmove(void* dest, const void* src, uint32_t n) {
  * Function: compares string 1 and string 2 for equality */
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
     int32_t i;
+
+    /* Strings aligned alike skip equal, unterminated words; the byte loop
+     * below then finds the difference or the end. Otherwise it's bytes
+     * all the way */
+    if (((uint32_t)s1 & WORD_MASK) == ((uint32_t)s2 & WORD_MASK)) {
+        for (; n > 0 && !WORD_ALIGNED(s1); s1++, s2++, n--) {
+            if ((*s1 != *s2) || (*s1 == '\0')) return *s1 - *s2;
+        }
+        for (; n >= sizeof(uint32_t); s1 += sizeof(uint32_t), s2 += sizeof(uint32_t), n -= sizeof(uint32_t)) {
+            uint32_t w = *(const uint32_t*)s1;
+            if (w != *(const uint32_t*)s2 || HAS_ZERO_BYTE(w)) break;
+        }
+    }
+
     for (i = 0; i < n; i++) {
         if ((s1[i] != s2[i]) || (s1[i] == '\0') /* || s2[i] == '\0' */) {
 
@@ -626,14 +970,27 @@ int8_t* strcpy(int8_t* dest, const int8_t* src) {
  * Function: copy n bytes of the source string into the destination string */
 int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
     int32_t i = 0;
+
+    /* Copy whole unterminated words while both sides are aligned alike */
+    if (((uint32_t)dest & WORD_MASK) == ((uint32_t)src & WORD_MASK)) {
+        for (; i < n && !WORD_ALIGNED(src + i); i++) {
+            if (src[i] == '\0') break;
+            dest[i] = src[i];
+        }
+        if (i < n && src[i] != '\0') {
+            for (; i + sizeof(uint32_t) <= n; i += sizeof(uint32_t)) {
+                uint32_t w = *(const uint32_t*)(src + i);
+                if (HAS_ZERO_BYTE(w)) break;
+                *(uint32_t*)(dest + i) = w;
+            }
+        }
+    }
+
     while (src[i] != '\0' && i < n) {
         dest[i] = src[i];
         i++;
     }
-    while (i < n) {
-        dest[i] = '\0';
-        i++;
-    }
+    if (i < n) memset(dest + i, '\0', n - i);
     return dest;
 }
 
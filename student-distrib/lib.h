@@ -14,16 +14,30 @@
 
 #define SHELL_OFFSET 7
 
+#define BLANK_CELL  ((ATTRIB << 8) | ' ')
+
+/* Word-at-a-time string scanning. HAS_ZERO_BYTE is nonzero exactly when
+ * one of the four bytes of w is zero: subtracting 1 from each byte sets a
+ * byte's top bit through a borrow only if it was zero (or a lower byte
+ * borrowed), and ~w masks out bytes whose top bit was already set */
+#define WORD_ONES           0x01010101
+#define WORD_HIGHS          0x80808080
+#define WORD_MASK           0x3
+#define HAS_ZERO_BYTE(w)    (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define WORD_ALIGNED(p)     (((uint32_t)(p) & WORD_MASK) == 0)
+
 char* get_video_mem();
 void set_video_mem(char* new_mem);
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
 int32_t puts(int8_t *s);
+int32_t write_text(const uint8_t* buf, int32_t n);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
 uint32_t strlen(const int8_t* s);
 void clear(void);
+void clear_text(uint32_t term);
 
 void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
@@ -36,15 +50,20 @@ int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 void test_interrupts(void);
 
 void update_cursor(int x, int y);
+void show_video_page(char* page, int x, int y);
 void print_backspace();
 void wrap_around(void);
 void scroll_handle(void);
+void scroll_view(int32_t lines);
 
 int32_t get_screen_x(void);
 int32_t get_screen_y(void);
 void set_screen_x(int x);
 void set_screen_y(int y);
 
+/* 64-bit by 32-bit division without libgcc */
+uint64_t udiv64(uint64_t n, uint32_t d);
+
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
 int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
@@ -52,7 +71,7 @@ int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
 /* Port read functions */
 /* Inb reads a byte and returns its value as a zero-extended 32-bit
  * unsigned int */
-static inline uint32_t inb(port) {
+static inline uint32_t inb(int32_t port) {
     uint32_t val;
     asm volatile ("             \n\
             xorl %0, %0         \n\
@@ -68,7 +87,7 @@ static inline uint32_t inb(port) {
 /* Reads two bytes from two consecutive ports, starting at "port",
  * concatenates them little-endian style, and returns them zero-extended
  * */
-static inline uint32_t inw(port) {
+static inline uint32_t inw(int32_t port) {
     uint32_t val;
     asm volatile ("             \n\
             xorl %0, %0         \n\
@@ -83,7 +102,7 @@ static inline uint32_t inw(port) {
 
 /* Reads four bytes from four consecutive ports, starting at "port",
  * concatenates them little-endian style, and returns them */
-static inline uint32_t inl(port) {
+static inline uint32_t inl(int32_t port) {
     uint32_t val;
     asm volatile ("inl (%w1), %0"
             : "=a"(val)
@@ -123,6 +142,15 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Reads the 64-bit time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint64_t val;
+    asm volatile ("rdtsc"
+            : "=A"(val)
+    );
+    return val;
+}
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
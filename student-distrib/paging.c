@@ -216,6 +216,10 @@ map_v_p(uint32_t virtual_addr,
             pte_4kb->ignored         = 0x0; /* doesn't matter */
             pte_4kb->ptr = physical_addr >> TABLE_ENTRY_PAGE_OFFSET;
         }
+
+        /* Only this one translation changed, so keep the rest of the TLB */
+        invlpg(virtual_addr);
+        return 0;
     } else {
         /* Get page dir entry                 */
         /*   ...2 because 2^2 bytes per entry */
@@ -249,6 +253,22 @@ map_v_p(uint32_t virtual_addr,
     return 0;
 }
 
+/* invlpg
+ *
+ * DESCRIPTION: Drops the TLB entry of a single page
+ * INPUT: virtual_addr - any address inside the page
+ * OUTPUT: none
+ * SIDE EFFECTS: invalidates one TLB entry
+ */
+void invlpg(uint32_t virtual_addr)
+{
+    asm volatile ("invlpg (%0)"
+        : /* no outputs */
+        : "r" (virtual_addr)
+        : "memory"
+    );
+}
+
 /* flush_tlb
  *
  * DESCRIPTION: Flushest the TLB
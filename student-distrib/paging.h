@@ -25,4 +25,6 @@ uint32_t map_v_p(uint32_t virtual_addr, uint32_t physical_addr,
     uint32_t read_write,
     uint32_t user_supervisor);
 void flush_tlb();
+/* Drops the TLB entry for one page */
+void invlpg(uint32_t virtual_addr);
 #endif
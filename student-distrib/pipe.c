@@ -0,0 +1,212 @@
+/* pipe.c - Pipes between processes
+ * vim:ts=4 noexpandtab
+ *
+ * A pipe is a page-sized ring buffer. Readers sleep while it is empty and
+ * writers while it is full, each on their own wait queue. Kernel code is
+ * never preempted (bottom halves run on the way back to user mode), so the
+ * ring needs no lock.
+ */
+
+#include "pipe.h"
+#include "lib.h"
+#include "sched.h"
+
+typedef struct {
+    uint32_t readers;           /* descriptors open on the read end  */
+    uint32_t writers;           /* descriptors open on the write end */
+    uint32_t head;              /* bytes read so far                  */
+    uint32_t tail;              /* bytes written so far               */
+    wait_queue_t read_wait;     /* readers waiting for data           */
+    wait_queue_t write_wait;    /* writers waiting for room           */
+} pipe_t;
+
+static pipe_t pipes[MAX_PIPES];
+static uint8_t pipe_buf[MAX_PIPES][PIPE_SIZE] __attribute__((aligned (PIPE_SIZE)));
+
+/* Each end refuses the other direction */
+static int32_t pipe_no_read(int32_t fd, void* buf, int32_t nbytes) {
+    return -1;
+}
+
+static int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
+
+fops_t pipe_read_funcs =
+{
+    .read = pipe_read,
+    .write = pipe_no_write,
+    .open = pipe_open,
+    .close = pipe_close
+};
+
+fops_t pipe_write_funcs =
+{
+    .read = pipe_no_read,
+    .write = pipe_write,
+    .open = pipe_open,
+    .close = pipe_close
+};
+
+/* pipe_of
+ *
+ * DESCRIPTION: The pipe behind one of the current process' descriptors;
+ *              its inode field holds the pipe's index
+ */
+static pipe_t* pipe_of(int32_t fd) {
+    return &pipes[get_current_PCB()->file_array[fd].inode];
+}
+
+/* pipe_alloc
+ *
+ * DESCRIPTION: Takes a free pipe, empty, with one descriptor on each end
+ * INPUTS: read_end, write_end - descriptors to fill in
+ * OUTPUTS: 0 on success, -1 if all pipes are in use
+ */
+int32_t pipe_alloc(fd_t* read_end, fd_t* write_end) {
+    uint32_t i;
+
+    for (i = 0; i < MAX_PIPES; i++) {
+        if (pipes[i].readers == 0 && pipes[i].writers == 0) break;
+    }
+    if (i == MAX_PIPES) return -1;
+
+    memset(&pipes[i], 0, sizeof(pipe_t));
+    pipes[i].readers = 1;
+    pipes[i].writers = 1;
+
+    read_end->fops = &pipe_read_funcs;
+    read_end->inode = i;
+    read_end->pos = 0;
+    read_end->flags = 1;
+
+    write_end->fops = &pipe_write_funcs;
+    write_end->inode = i;
+    write_end->pos = 0;
+    write_end->flags = 1;
+    return 0;
+}
+
+/* pipe_dup
+ *
+ * DESCRIPTION: Counts a copy of a descriptor made by dup2 or execute, so
+ *              the end stays open until every copy is closed
+ * INPUTS: end - descriptor being copied
+ * OUTPUTS: None
+ */
+void pipe_dup(const fd_t* end) {
+    if (end->fops == &pipe_read_funcs) {
+        pipes[end->inode].readers++;
+    } else {
+        pipes[end->inode].writers++;
+    }
+}
+
+/* is_pipe
+ *
+ * DESCRIPTION: Tells pipe descriptors apart from files and devices
+ * INPUTS: fd - an open descriptor
+ * OUTPUTS: 1 for either end of a pipe, else 0
+ */
+int32_t is_pipe(const fd_t* fd) {
+    return fd->fops == &pipe_read_funcs || fd->fops == &pipe_write_funcs;
+}
+
+/* pipe_read
+ *
+ * DESCRIPTION: Reads what is in the pipe, up to nbytes, sleeping while it
+ *              is empty and still has a writer
+ * INPUTS: fd - read end, buf - destination, nbytes - most bytes to read
+ * OUTPUTS: bytes read, 0 at end of file once every writer closed, or -1 if
+ *          no other process could ever fill it
+ */
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes) {
+    pipe_t* p = pipe_of(fd);
+    uint8_t* ring = pipe_buf[p - pipes];
+    uint32_t count, offset, first;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    while (p->tail == p->head && nbytes > 0) {
+        if (p->writers == 0) return 0;
+        if (sleep_on(&p->read_wait) != 0) return -1;
+    }
+
+    count = p->tail - p->head;
+    if (count > (uint32_t)nbytes) count = nbytes;
+
+    /* At most two pieces: up to the end of the page, then from its start */
+    offset = p->head % PIPE_SIZE;
+    first = (count < PIPE_SIZE - offset) ? count : PIPE_SIZE - offset;
+    memcpy(buf, ring + offset, first);
+    memcpy((uint8_t*)buf + first, ring, count - first);
+    p->head += count;
+
+    wake_up(&p->write_wait);
+    return count;
+}
+
+/* pipe_write
+ *
+ * DESCRIPTION: Writes all of buf, sleeping whenever the pipe is full
+ * INPUTS: fd - write end, buf - source, nbytes - bytes to write
+ * OUTPUTS: nbytes, or fewer if the readers went away or no other process
+ *          could ever empty it; -1 if nothing was written
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes) {
+    pipe_t* p = pipe_of(fd);
+    uint8_t* ring = pipe_buf[p - pipes];
+    uint32_t done, count, offset, first;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    for (done = 0; done < (uint32_t)nbytes; done += count) {
+        if (p->readers == 0) break;
+
+        count = PIPE_SIZE - (p->tail - p->head);
+        if (count == 0) {
+            if (sleep_on(&p->write_wait) != 0) break;
+            continue;
+        }
+        if (count > nbytes - done) count = nbytes - done;
+
+        offset = p->tail % PIPE_SIZE;
+        first = (count < PIPE_SIZE - offset) ? count : PIPE_SIZE - offset;
+        memcpy(ring + offset, (const uint8_t*)buf + done, first);
+        memcpy(ring, (const uint8_t*)buf + done + first, count - first);
+        p->tail += count;
+
+        wake_up(&p->read_wait);
+    }
+
+    if (done == 0 && nbytes > 0) return -1;
+    return done;
+}
+
+/* pipe_open
+ *
+ * DESCRIPTION: Pipes have no name; they are only made by the pipe call
+ * OUTPUTS: -1
+ */
+int32_t pipe_open(const uint8_t* filename) {
+    return -1;
+}
+
+/* pipe_close
+ *
+ * DESCRIPTION: Drops one descriptor of an end. Readers see end of file once
+ *              the last writer is gone, writers fail once the last reader is
+ * INPUTS: fd - either end
+ * OUTPUTS: 0
+ */
+int32_t pipe_close(int32_t fd) {
+    fd_t* end = &get_current_PCB()->file_array[fd];
+    pipe_t* p = &pipes[end->inode];
+
+    if (end->fops == &pipe_read_funcs) {
+        if (--p->readers == 0) wake_up(&p->write_wait);
+    } else {
+        if (--p->writers == 0) wake_up(&p->read_wait);
+    }
+    return 0;
+}
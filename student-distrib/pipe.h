@@ -0,0 +1,28 @@
+/* pipe.h - Pipes between processes
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _PIPE_H
+#define _PIPE_H
+#include "types.h"
+#include "syscalls.h"
+
+#define MAX_PIPES           8
+#define PIPE_SIZE           4096    /* one page of ring buffer per pipe */
+
+/* File operations of the two ends */
+extern fops_t pipe_read_funcs;
+extern fops_t pipe_write_funcs;
+
+/* Makes a pipe and fills in a descriptor for each end; -1 if none is free */
+int32_t pipe_alloc(fd_t* read_end, fd_t* write_end);
+/* Counts another descriptor referring to the same end */
+void pipe_dup(const fd_t* end);
+/* 1 if the descriptor is either end of a pipe */
+int32_t is_pipe(const fd_t* fd);
+
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_open(const uint8_t* filename);
+int32_t pipe_close(int32_t fd);
+
+#endif /* _PIPE_H */
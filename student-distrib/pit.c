@@ -6,9 +6,9 @@
 #include "sched.h"
 #include "utils/char_util.h"
 #include "syscalls.h"
+#include "softirq.h"
 
 #define INT_INTERVAL                 15 // timer interrupt interval in ms
-#define PIT_IRQ                     0x00
 
 #define MAX_FREQ                    1193182
 #define MS_IN_SEC                   1000
@@ -19,12 +19,27 @@
 #define BYTE_SIZE                   8
 
 
+/*  pit_handler
+ *  DESCRIPTION: Top half of the timer interrupt. Only asks for a reschedule;
+ *               the task switch itself happens in pit_bottom_half
+ *  INPUT: None
+ *  OUTPUT: None
+ */
 void pit_handler() {
+    raise_softirq(SOFTIRQ_TIMER);
+    send_eoi(PIT_IRQ);
+}
+
+/*  pit_bottom_half
+ *  DESCRIPTION: Moves to the next terminal's task, starting a shell there
+ *               if it has none
+ *  INPUT: None
+ *  OUTPUT: None
+ */
+static void pit_bottom_half() {
     if (cycle_task()) {
-        send_eoi(PIT_IRQ);
         execute(dechar("shell"));
     }
-    send_eoi(PIT_IRQ);
 }
 
 /*  pit_init
@@ -41,5 +56,6 @@ void pit_init() {
     outb((uint8_t) (divisor & BYTE_MASK), PIT_CH0);
     outb((uint8_t) ((divisor >> BYTE_SIZE) & BYTE_MASK), PIT_CH0);
 
+    open_softirq(SOFTIRQ_TIMER, PIT_IRQ, pit_bottom_half);
     enable_irq(PIT_IRQ);
 }
@@ -6,6 +6,8 @@
 #include "types.h"
 #include "lib.h"
 
+#define PIT_IRQ                     0x00
+
 extern void pit_handler();
 extern void pit_init();
 
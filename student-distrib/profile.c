@@ -0,0 +1,196 @@
+/* profile.c - Statistical sampling profiler
+ * vim:ts=4 noexpandtab
+ */
+
+#include "profile.h"
+#include "lib.h"
+#include "sched.h"
+#include "serial.h"
+#include "syscalls.h"
+#include "filesys.h"
+
+#define PIT_IRQ             0x00
+#define RTC_IRQ             0x08
+
+#define NO_PID              0xFFFF
+#define PROFILE_ENTRIES     (MAX_DEVICES + PROFILE_SLOTS + 1)
+#define LINE_LEN            64
+#define HEX                 16
+#define DEC                 10
+
+typedef struct {
+    uint32_t eip;
+    uint32_t count;     /* 0 marks a free slot */
+    uint16_t pid;
+} profile_slot_t;
+
+volatile uint32_t profile_on = 0;
+
+static profile_slot_t profile_hist[PROFILE_SLOTS];
+static uint32_t profile_dropped;    /* samples that found the table full */
+static uint8_t profile_names[MAX_DEVICES][FNAME_MAX_LEN + 1];
+
+/* profile_sample
+ *
+ * DESCRIPTION: Called from irq_exit with interrupts off. Bumps the counter of
+ *              the interrupted (pid, eip) pair, using linear probing
+ * INPUTS: irq - line that fired; only the PIT and RTC take samples
+ *         eip - interrupted instruction pointer
+ * OUTPUTS: None
+ */
+void profile_sample(uint32_t irq, uint32_t eip) {
+    uint32_t i, h;
+    uint16_t pid;
+
+    if (irq != PIT_IRQ && irq != RTC_IRQ) return;
+
+    pid = (running_terminal < MAX_TERMINAL_NUM && running_procs[running_terminal] >= 0)
+        ? (uint16_t)running_procs[running_terminal] : NO_PID;
+
+    /* Knuth's multiplicative hash; eips of nearby code spread out */
+    h = ((eip ^ ((uint32_t)pid << 24)) * 2654435761U) >> 20;
+    for (i = 0; i < PROFILE_SLOTS; i++) {
+        profile_slot_t* slot = &profile_hist[(h + i) & PROFILE_SLOT_MASK];
+        if (slot->count == 0) {
+            slot->eip = eip;
+            slot->pid = pid;
+            slot->count = 1;
+            return;
+        }
+        if (slot->eip == eip && slot->pid == pid) {
+            slot->count++;
+            return;
+        }
+    }
+    profile_dropped++;
+}
+
+/* profile_exec
+ *
+ * DESCRIPTION: Records the program a pid was just given. Samples of earlier
+ *              programs with the same pid stay under that pid, so reset the
+ *              profiler between runs to keep them apart
+ * INPUTS: pid, name - executable's file name
+ * OUTPUTS: None
+ */
+void profile_exec(int32_t pid, const uint8_t* name) {
+    if (pid < 0 || pid >= MAX_DEVICES) return;
+    strncpy((int8_t*)profile_names[pid], (const int8_t*)name, FNAME_MAX_LEN);
+    profile_names[pid][FNAME_MAX_LEN] = '\0';
+}
+
+/* profile_line
+ *
+ * DESCRIPTION: Formats entry number index of the dump: MAX_DEVICES name lines,
+ *              one line per used histogram slot, then the dropped count
+ * INPUTS: index - entry number
+ *         line - LINE_LEN byte destination
+ * OUTPUTS: length of the line, 0 if the entry is empty
+ */
+static int32_t profile_line(uint32_t index, int8_t* line) {
+    int8_t num[LINE_LEN];
+    profile_slot_t* slot;
+
+    line[0] = '\0';
+    if (index < MAX_DEVICES) {
+        if (profile_names[index][0] == '\0') return 0;
+        strcpy(line, "@prof-name ");
+        strcpy(line + strlen(line), itoa(index, num, DEC));
+        strcpy(line + strlen(line), " ");
+        strncpy(line + strlen(line), (int8_t*)profile_names[index], FNAME_MAX_LEN + 1);
+    } else if (index == MAX_DEVICES + PROFILE_SLOTS) {
+        if (profile_dropped == 0) return 0;
+        strcpy(line, "@prof-dropped ");
+        strcpy(line + strlen(line), itoa(profile_dropped, num, DEC));
+    } else {
+        slot = &profile_hist[index - MAX_DEVICES];
+        if (slot->count == 0) return 0;
+        strcpy(line, "@prof ");
+        strcpy(line + strlen(line), itoa(slot->pid, num, DEC));
+        strcpy(line + strlen(line), " ");
+        strcpy(line + strlen(line), itoa(slot->eip, num, HEX));
+        strcpy(line + strlen(line), " ");
+        strcpy(line + strlen(line), itoa(slot->count, num, DEC));
+    }
+    strcpy(line + strlen(line), "\n");
+    return strlen(line);
+}
+
+/* profile_read
+ *
+ * DESCRIPTION: Returns as many whole dump lines as fit, continuing from the
+ *              file position on the next call. A line longer than the whole
+ *              buffer is cut short rather than read as the end of the dump
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: bytes copied, 0 at the end of the dump
+ */
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes) {
+    fd_t* file = &get_current_PCB()->file_array[fd];
+    int8_t line[LINE_LEN];
+    int32_t len, count = 0;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    while (file->pos < PROFILE_ENTRIES) {
+        len = profile_line(file->pos, line);
+        if (count + len > nbytes) {
+            if (count != 0) break;
+            len = nbytes;
+        }
+        memcpy((uint8_t*)buf + count, line, len);
+        count += len;
+        file->pos++;
+    }
+    return count;
+}
+
+/* profile_write
+ *
+ * DESCRIPTION: Runs one control command
+ * INPUTS: buf - "start", "stop", "reset" or "dump", optionally newline ended
+ * OUTPUTS: nbytes on success, -1 for an unknown command
+ */
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes) {
+    const int8_t* cmd = (const int8_t*)buf;
+    int8_t line[LINE_LEN];
+    uint32_t i;
+    int32_t len;
+
+    if (buf == NULL || nbytes <= 0) return -1;
+
+    if (nbytes >= 5 && !strncmp(cmd, "start", 5)) {
+        profile_on = 1;
+    } else if (nbytes >= 4 && !strncmp(cmd, "stop", 4)) {
+        profile_on = 0;
+    } else if (nbytes >= 5 && !strncmp(cmd, "reset", 5)) {
+        cli_and_save(i);
+        memset(profile_hist, 0, sizeof(profile_hist));
+        profile_dropped = 0;
+        restore_flags(i);
+    } else if (nbytes >= 4 && !strncmp(cmd, "dump", 4)) {
+        for (i = 0; i < PROFILE_ENTRIES; i++) {
+            if ((len = profile_line(i, line)) > 0) serial_write(0, line, len);
+        }
+    } else {
+        return -1;
+    }
+    return nbytes;
+}
+
+/* profile_open
+ *
+ * DESCRIPTION: Nothing to set up, reading starts at the top of the dump
+ * OUTPUT: 0
+ */
+int32_t profile_open(const uint8_t* filename) {
+    return 0;
+}
+
+/* profile_close
+ *
+ * DESCRIPTION: Nothing to tear down
+ * OUTPUT: 0
+ */
+int32_t profile_close(int32_t fd) {
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* profile.h - Statistical sampling profiler
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _PROFILE_H
+#define _PROFILE_H
+#include "types.h"
+
+/* Distinct (pid, eip) pairs kept; must be a power of two */
+#define PROFILE_SLOTS       4096
+#define PROFILE_SLOT_MASK   (PROFILE_SLOTS - 1)
+
+/* Nonzero while samples are being taken */
+extern volatile uint32_t profile_on;
+
+/* Record the interrupted EIP if irq is a sampling source */
+void profile_sample(uint32_t irq, uint32_t eip);
+/* Remember which program a pid runs, for the dump */
+void profile_exec(int32_t pid, const uint8_t* name);
+
+/* The "profile" device. Writing "start", "stop", "reset" or "dump" controls
+ * the profiler ("dump" copies the profile to the serial port); reading it
+ * returns the profile as text lines:
+ *   @prof-name <pid> <program>
+ *   @prof <pid> <eip in hex> <samples>
+ *   @prof-dropped <samples that found the table full> */
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t profile_open(const uint8_t* filename);
+int32_t profile_close(int32_t fd);
+
+#endif /* _PROFILE_H */
@@ -9,6 +9,7 @@
 #include "i8259.h"
 #include "debug.h"
 #include "tests.h"
+#include "softirq.h"
 
 #define RTC_IRQ             0x08 // Port on Slave PIC
 #define RTC_VEC             0x28 // IDT Vector
@@ -107,7 +108,8 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes) {
 
     sti();
     while(!IR_flag){
-       
+        /* Let deferred work (and the scheduler) run while we wait */
+        do_softirq();
     }
     IR_flag = 0;
 
@@ -3,6 +3,8 @@
 #include "paging.h"
 #include "terminal.h"
 #include "syscalls.h"
+#include "trace.h"
+#include "fpu.h"
 #include "utils/char_util.h"
 #include "lib.h"
 
@@ -25,24 +27,103 @@ void sched_init() {
     int x;
     for(x = 0; x < MAX_DEVICES; x++) {
         term_procs[x] = -1;
+        proc_state[x] = PROC_FREE;
     }
     for (x = 0; x < MAX_TERMINAL_NUM; x++) {
         running_procs[x] = -1;
         map_v_p(get_term_vid_addr(x), get_term_vid_addr(x), 0, 1, 1);
-        memcpy((void *) get_term_vid_addr(x), (void *) VIDEO, (uint32_t) PAGE_SIZE_KB);
+        /* Terminal 0's page is the boot screen; blank the others, and
+         * their text so scrolling copies blank cells back */
+        if (x != 0) {
+            memset_word((void *) get_term_vid_addr(x), BLANK_CELL, NUM_ROWS * NUM_COLS);
+            clear_text(x);
+        }
     }
 }
 
 /*  cycle_task
 *   DESCRIPTION: function to call for the OS to move to another task,
-*                  to be called periodically by PIT
+*                  to be called periodically by PIT. Each turn of a terminal
+*                  goes to its next runnable process, so pipeline stages
+*                  share the terminal's time
 *   INPUTS: none
 *   OUTPUTS: none
 *   RETURNS: 0 if success, 1 if nothing is running on this terminal
 *   SIDE EFFECTS: switches tasks running in CPU
 */
 uint32_t cycle_task() {
-    return switch_running_terminal((running_terminal + 1) % 3);
+    uint32_t next_terminal = (running_terminal + 1) % MAX_TERMINAL_NUM;
+    int32_t next_p_id = running_procs[next_terminal];
+
+    if (next_p_id >= 0) {
+        next_p_id = next_runnable(next_terminal, next_p_id);
+        /* Everything there is asleep; whoever wakes it runs it */
+        if (next_p_id < 0) return 0;
+        running_procs[next_terminal] = next_p_id;
+    }
+    return switch_running_terminal(next_terminal);
+}
+
+/*  switch_process
+*   DESCRIPTION: Saves the current process' kernel stack and resumes another
+*                where it left off, or starts it in user mode if it never ran.
+*                Every paused process is paused here, so restoring its esp/ebp
+*                returns through this same frame
+*   INPUTS: cur_p_id  -- process giving up the CPU, or -1
+*           next_p_id -- process to run
+*   OUTPUTS: None
+*   SIDE EFFECTS: switches tasks running in CPU
+*/
+static void __attribute__((noinline)) switch_process(int32_t cur_p_id, int32_t next_p_id) {
+    pcb_t* next_pcb_ptr = find_PCB(next_p_id);
+    uint32_t eip;
+
+    TRACE(TRACE_SWITCH, next_p_id);
+
+    // SAVE ESP/EBP
+    if (cur_p_id >= 0) {
+        pcb_t* cur_pcb_ptr = find_PCB(cur_p_id);
+        asm volatile ("                               \n\
+            movl %%esp, %0                            \n\
+            movl %%ebp, %1                            \n\
+            "
+            : "=r"(cur_pcb_ptr->esp), "=r"(cur_pcb_ptr->ebp)
+            : /* no inputs */
+            : "cc"
+        );
+    }
+
+    map_v_p(USER_PROCESS_START_VIRTUAL, USER_PROCESS_START_PHYSICAL + next_p_id * USER_PROCESS_SIZE, 1, 1, 1);
+
+    /* Incoming task sees its own terminal's video page, if it asked for one */
+    remap_vidmap(next_p_id);
+
+    /* Its FPU registers are loaded lazily, on its first FPU instruction */
+    fpu_switch();
+
+    flush_tlb();
+
+    /* Its next entry from user mode starts at the top of its kernel stack,
+     * wherever in a system call it was paused */
+    tss.esp0 = (KERNEL_MEMORY_ADDR + MB_4) - next_p_id * PCB_SIZE - 4;
+
+    /* A process execute left to run alongside its parent starts here */
+    if (next_pcb_ptr->start_eip != 0) {
+        eip = next_pcb_ptr->start_eip;
+        next_pcb_ptr->start_eip = 0;
+        enter_user(eip, next_pcb_ptr->start_esp);
+    }
+
+    /* === CONTEXT SWITCH === */
+    /* Restore next process' esp/ebp */
+    asm volatile("           		  	\n\
+        movl    %0, %%esp               \n\
+        movl    %1, %%ebp               \n\
+        "
+        :
+        : "r"(next_pcb_ptr->esp), "r"(next_pcb_ptr->ebp)
+        : "cc", "memory"
+    );
 }
 
 /*  switch_running_terminal
@@ -56,67 +137,139 @@ uint32_t switch_running_terminal(uint32_t next_terminal) {
     /* Get next process id which we will switch to */
     int32_t cur_p_id = running_procs[running_terminal];
     int32_t next_p_id = running_procs[next_terminal];
+
+    /* Text output follows the running terminal to its own video page */
+    save_term_pos(running_terminal);
     running_terminal = next_terminal;
+    restore_term_pos(running_terminal);
+    set_video_mem((char*) get_term_vid_addr(running_terminal));
 
     if (next_p_id < 0) {
-        if (running_terminal == display_terminal) set_video_mem((char*) VIDEO);
-        else set_video_mem((char*) get_term_vid_addr(running_terminal));
         return 1;
     }
 
-    // SAVE ESP/EBP
-    pcb_t* cur_pcb_ptr = find_PCB(cur_p_id);
-    asm volatile ("                               \n\
-        movl %%esp, %0                            \n\
-        movl %%ebp, %1                            \n\
-        "
-        : "=r"(cur_pcb_ptr->esp), "=r"(cur_pcb_ptr->ebp)
-        : /* no inputs */
-        : "cc"
-    );
+    switch_process(cur_p_id, next_p_id);
+    return 0;
+}
 
-    map_v_p(USER_PROCESS_START_VIRTUAL, USER_PROCESS_START_PHYSICAL + next_p_id * USER_PROCESS_SIZE, 1, 1, 1);
+/*  next_runnable
+*   DESCRIPTION: Round robin over a terminal's runnable processes
+*   INPUTS: term  -- the terminal
+*           after -- process to start looking after; it is checked last
+*   OUTPUTS: None
+*   RETURNS: the process id, or -1 if none is runnable
+*/
+int32_t next_runnable(uint32_t term, int32_t after) {
+    int32_t i, pid;
 
-    /* Map memory to appriate physical location */
-    // if next process is in open terminal, map virtual video memory to
-    //   physical video memory
-    if (term_procs[next_p_id] == display_terminal) {
-        set_video_mem((char*) VIDEO);
+    for (i = 1; i <= MAX_DEVICES; i++) {
+        pid = (after + i + MAX_DEVICES) % MAX_DEVICES;
+        if (term_procs[pid] == term && proc_state[pid] == PROC_RUNNABLE) {
+            return pid;
+        }
     }
+    return -1;
+}
 
-    // if next process is not in open terminal, map virtual video memory
-    //   to task's non-display memory
-    else {
-        set_video_mem((char*) get_term_vid_addr(term_procs[next_p_id]));
-    }
+/*  sched_yield
+*   DESCRIPTION: Runs the next runnable process on this terminal, if there is
+*                another. Lets pipeline stages make progress while a process
+*                waits for input without the PIT
+*   INPUTS: None
+*   OUTPUTS: None
+*   SIDE EFFECTS: may switch tasks; returns when this process is picked again
+*/
+void sched_yield(void) {
+    int32_t cur_p_id, next_p_id;
 
-    /* CONTEXT SWITCH (do something similar to HALT) */
+    /* Not in a process, e.g. the kernel's own tests */
+    if (running_terminal >= MAX_TERMINAL_NUM || running_procs[running_terminal] < 0) return;
 
-    // TODO: DO SOMETHING WITH VIDMAP?
-    //  if it was previously called on the incoming task, do we have to remap it?
-    //  And if it was called on the outgoing task, do we have to unmap it?
+    cur_p_id = running_procs[running_terminal];
+    next_p_id = next_runnable(running_terminal, cur_p_id);
+    if (next_p_id < 0 || next_p_id == cur_p_id) return;
 
-    // The answer to this ^^ was no right? Because it should only be called for the main task that has the screen spaces
-    // Although makes me wonder about if we run fish from multiple terminals
+    running_procs[running_terminal] = next_p_id;
+    switch_process(cur_p_id, next_p_id);
+}
 
+/*  sleep_on
+*   DESCRIPTION: Blocks the current process on a wait queue and runs another
+*                one on its terminal. Wake-ups may be spurious, so callers
+*                check their condition again in a loop
+*   INPUTS: wq -- the wait queue
+*   OUTPUTS: None
+*   RETURNS: 0 once woken, -1 without sleeping if no other process on the
+*            terminal is runnable, as nothing could wake us
+*/
+int32_t sleep_on(wait_queue_t* wq) {
+    int32_t cur_p_id, next_p_id;
 
-    /* === CONTEXT SWITCH === */
-	/* Update stack pointers and base pointers */
+    if (running_terminal >= MAX_TERMINAL_NUM || running_procs[running_terminal] < 0) return -1;
 
-    flush_tlb();
+    cur_p_id = running_procs[running_terminal];
+    next_p_id = next_runnable(running_terminal, cur_p_id);
+    if (next_p_id < 0 || next_p_id == cur_p_id) return -1;
 
-    /* Update TSS */
-    /* Restore next process' esp/ebp */
-    pcb_t* next_pcb_ptr = find_PCB(next_p_id);
-    /* Update TSS */
-    tss.esp0 = next_pcb_ptr->esp;
-    asm volatile("           		  	\n\
-        movl    %0, %%esp               \n\
-        movl    %1, %%ebp               \n\
-        "
-        :
-        : "r"(next_pcb_ptr->esp), "r"(next_pcb_ptr->ebp)
-        : "cc", "memory"
-    );
+    wq->pids |= 1 << cur_p_id;
+    proc_state[cur_p_id] = PROC_BLOCKED;
+    running_procs[running_terminal] = next_p_id;
+    switch_process(cur_p_id, next_p_id);
+
+    wq->pids &= ~(1 << cur_p_id);
     return 0;
 }
+
+/*  wake_up
+*   DESCRIPTION: Makes every process asleep on a wait queue runnable. They
+*                run when the caller sleeps, yields or halts, or on a tick
+*   INPUTS: wq -- the wait queue
+*   OUTPUTS: None
+*/
+void wake_up(wait_queue_t* wq) {
+    int32_t pid;
+
+    for (pid = 0; wq->pids != 0 && pid < MAX_DEVICES; pid++) {
+        if (!(wq->pids & (1 << pid))) continue;
+        wq->pids &= ~(1 << pid);
+        if (proc_state[pid] == PROC_BLOCKED) proc_state[pid] = PROC_RUNNABLE;
+    }
+}
+
+/*  sched_exit
+*   DESCRIPTION: Called by halt for a process that ran alongside its parent,
+*                so there is no execute to return to. Runs the terminal's
+*                next runnable process instead. If everything left is
+*                asleep, nothing can wake it, so it is woken to fail its wait
+*   INPUTS: pid  -- the halted process, already deleted
+*           term -- the terminal it ran on
+*   OUTPUTS: None
+*   SIDE EFFECTS: does not return; idles if a new shell can't be started
+*/
+void sched_exit(int32_t pid, uint32_t term) {
+    int32_t next_p_id = next_runnable(term, pid);
+    int32_t i;
+
+    if (next_p_id < 0) {
+        for (i = 0; i < MAX_DEVICES; i++) {
+            if (term_procs[i] == term && proc_state[i] == PROC_BLOCKED) {
+                proc_state[i] = PROC_RUNNABLE;
+            }
+        }
+        next_p_id = next_runnable(term, pid);
+    }
+    if (next_p_id < 0) {
+        /* Nothing left on this terminal. execute only comes back if no new
+         * shell could run, and there is no frame to switch to, so the
+         * terminal idles until a tick moves on to another one */
+        running_procs[term] = -1;
+        execute(dechar("shell"));
+        printf("Could not restart shell\n");
+        while (1) {
+            asm volatile ("sti; hlt");
+        }
+    }
+
+    running_procs[term] = next_p_id;
+    switch_process(-1, next_p_id);
+}
@@ -2,14 +2,30 @@
 #define _SCHED_H
 #include "types.h"
 
-#define MAX_TERMINAL_NUM 3
-#define MAX_DEVICES 6
+#define MAX_TERMINAL_NUM 4
+#define NUM_VGA_TERMINALS 3  // Terminals that can be displayed (Alt+F1..F3)
+#define SERIAL_TERMINAL 3    // Terminal driven over COM1 instead of the keyboard
+#define MAX_DEVICES 8
 
 uint32_t display_terminal;  // The currently displayed terminal
 uint32_t running_terminal;  // The currently running terminal
 
 int32_t term_procs[MAX_DEVICES];  // Says which process is running on which terminal
-int32_t running_procs[MAX_TERMINAL_NUM];  // The foremost processes in each terminal
+int32_t running_procs[MAX_TERMINAL_NUM];  // The process each terminal is running now
+
+/* Process states. A terminal takes turns among its runnable processes,
+ * e.g. the stages of a pipeline */
+#define PROC_FREE       0
+#define PROC_RUNNABLE   1   // Running, or ready to run
+#define PROC_WAITING    2   // In execute, until its child halts
+#define PROC_BLOCKED    3   // Asleep on a wait queue
+
+int32_t proc_state[MAX_DEVICES];
+
+/* Processes asleep until an event, one bit per process id */
+typedef struct {
+    uint32_t pids;
+} wait_queue_t;
 
 /* Initialize scheduler */
 extern void sched_init();
@@ -17,5 +33,15 @@ extern void sched_init();
 extern uint32_t cycle_task();
 /* Move to the task in the given terminal */
 extern uint32_t switch_running_terminal();
+/* Next runnable process on a terminal after the given one, or -1 */
+extern int32_t next_runnable(uint32_t term, int32_t after);
+/* Let another runnable process on this terminal run */
+extern void sched_yield(void);
+/* Sleep until woken; -1 if nothing else on the terminal could wake us */
+extern int32_t sleep_on(wait_queue_t* wq);
+/* Make everything asleep on wq runnable */
+extern void wake_up(wait_queue_t* wq);
+/* Leave a halted process' stack for the next one on its terminal */
+extern void sched_exit(int32_t pid, uint32_t term);
 
 #endif /* _SCHED_H */
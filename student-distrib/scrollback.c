@@ -0,0 +1,101 @@
+/* scrollback.c - Per-terminal history of lines scrolled off the screen
+ * vim:ts=4 noexpandtab
+ */
+
+#include "scrollback.h"
+#include "lib.h"
+#include "sched.h"
+
+#define SCROLLBACK_MASK     (SCROLLBACK_LINES - 1)
+#define CELL_ATTR(cell)     ((uint8_t)((cell) >> 8))
+#define CELL_CHAR(cell)     ((uint8_t)(cell))
+
+/* A history line stores only its characters and one attribute. Lines whose
+ * cells differ in attribute also borrow a slot in a small per-terminal pool,
+ * which is recycled round-robin; once a slot has been reused the line falls
+ * back to its single attribute */
+typedef struct {
+    uint8_t chars[NUM_COLS];
+    uint8_t attr;       /* attribute of the first cell           */
+    uint8_t mixed;      /* 1 if per-cell attributes were pooled  */
+    uint16_t slot;      /* pool slot, when mixed                 */
+} sb_line_t;
+
+typedef struct {
+    uint32_t owner;             /* line number that last filled the slot */
+    uint8_t attrs[NUM_COLS];
+} sb_attrs_t;
+
+static sb_line_t sb_lines[MAX_TERMINAL_NUM][SCROLLBACK_LINES];
+static sb_attrs_t sb_attrs[MAX_TERMINAL_NUM][SCROLLBACK_MIXED];
+static uint32_t sb_total[MAX_TERMINAL_NUM];     /* lines ever pushed     */
+static uint32_t sb_next_slot[MAX_TERMINAL_NUM]; /* next pool slot to use */
+
+/* scrollback_push
+ *
+ * DESCRIPTION: Saves a row that scrolled off the top of a terminal,
+ *              overwriting the oldest line once the history is full
+ * INPUTS: term - terminal index
+ *         row  - NUM_COLS character/attribute cells
+ * OUTPUTS: None
+ */
+void scrollback_push(uint32_t term, const uint16_t* row) {
+    uint32_t n = sb_total[term];
+    sb_line_t* line = &sb_lines[term][n & SCROLLBACK_MASK];
+    sb_attrs_t* pool;
+    uint8_t attr = CELL_ATTR(row[0]);
+    uint32_t x, mixed = 0;
+
+    for (x = 0; x < NUM_COLS; x++) {
+        line->chars[x] = CELL_CHAR(row[x]);
+        mixed |= (CELL_ATTR(row[x]) != attr);
+    }
+    line->attr = attr;
+    line->mixed = mixed;
+
+    if (mixed) {
+        line->slot = sb_next_slot[term];
+        sb_next_slot[term] = (sb_next_slot[term] + 1) % SCROLLBACK_MIXED;
+
+        pool = &sb_attrs[term][line->slot];
+        pool->owner = n;
+        for (x = 0; x < NUM_COLS; x++) {
+            pool->attrs[x] = CELL_ATTR(row[x]);
+        }
+    }
+    sb_total[term] = n + 1;
+}
+
+/* scrollback_count
+ *
+ * DESCRIPTION: Number of lines that can be scrolled back to
+ * INPUTS: term - terminal index
+ * OUTPUTS: line count, at most SCROLLBACK_LINES
+ */
+uint32_t scrollback_count(uint32_t term) {
+    return (sb_total[term] < SCROLLBACK_LINES) ? sb_total[term] : SCROLLBACK_LINES;
+}
+
+/* scrollback_line
+ *
+ * DESCRIPTION: Expands one history line back into screen cells
+ * INPUTS: term  - terminal index
+ *         back  - how far above the screen, 1 is the newest line; must be
+ *                 between 1 and scrollback_count(term)
+ *         cells - destination for NUM_COLS cells
+ * OUTPUTS: None
+ */
+void scrollback_line(uint32_t term, uint32_t back, uint16_t* cells) {
+    uint32_t n = sb_total[term] - back;
+    sb_line_t* line = &sb_lines[term][n & SCROLLBACK_MASK];
+    sb_attrs_t* pool = NULL;
+    uint32_t x;
+
+    if (line->mixed && sb_attrs[term][line->slot].owner == n) {
+        pool = &sb_attrs[term][line->slot];
+    }
+
+    for (x = 0; x < NUM_COLS; x++) {
+        cells[x] = ((pool ? pool->attrs[x] : line->attr) << 8) | line->chars[x];
+    }
+}
@@ -0,0 +1,20 @@
+/* scrollback.h - Per-terminal history of lines scrolled off the screen
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _SCROLLBACK_H
+#define _SCROLLBACK_H
+
+#include "types.h"
+
+#define SCROLLBACK_LINES    2048    /* per terminal, must be a power of two */
+#define SCROLLBACK_MIXED    64      /* lines per terminal that keep per-cell attributes */
+
+/* Save a screen row (NUM_COLS cells) that just scrolled off the top */
+void scrollback_push(uint32_t term, const uint16_t* row);
+/* Number of history lines currently available */
+uint32_t scrollback_count(uint32_t term);
+/* Expand the line `back` rows above the screen (1 = newest) into cells */
+void scrollback_line(uint32_t term, uint32_t back, uint16_t* cells);
+
+#endif /* _SCROLLBACK_H */
@@ -0,0 +1,262 @@
+/* serial.c - 16550 UART driver for COM1
+ * vim:ts=4 noexpandtab
+ */
+
+#include "serial.h"
+#include "lib.h"
+#include "i8259.h"
+#include "softirq.h"
+
+#define COM1                0x3F8
+
+/* Register offsets from the base port */
+#define UART_DATA           0   /* RX/TX holding, divisor low with DLAB */
+#define UART_IER            1   /* interrupt enable, divisor high with DLAB */
+#define UART_IIR            2   /* interrupt identification (read) */
+#define UART_FCR            2   /* FIFO control (write) */
+#define UART_LCR            3
+#define UART_MCR            4
+#define UART_LSR            5
+
+#define IER_RX              0x01 /* received data available */
+#define IER_TX              0x02 /* transmit holding register empty */
+#define IIR_NONE            0x01 /* no interrupt pending */
+#define FCR_ENABLE_CLEAR    0xC7 /* enable + clear both FIFOs, 14 byte RX trigger */
+#define LCR_DLAB            0x80
+#define LCR_8N1             0x03
+#define MCR_DTR_RTS_OUT2    0x0B /* OUT2 gates the IRQ line on PCs */
+#define LSR_DR              0x01 /* data ready */
+#define LSR_THRE            0x20 /* transmit holding register empty */
+#define LSR_TEMT            0x40 /* transmitter completely idle */
+
+#define BAUD_DIVISOR        1    /* 115200 baud */
+#define TX_FIFO_SIZE        16
+
+#define TX_RING_SIZE        4096
+#define TX_RING_MASK        (TX_RING_SIZE - 1)
+#define RX_RING_SIZE        256
+#define RX_RING_MASK        (RX_RING_SIZE - 1)
+
+static uint8_t tx_ring[TX_RING_SIZE];
+static volatile uint32_t tx_head, tx_tail;
+static uint8_t rx_ring[RX_RING_SIZE];
+static volatile uint32_t rx_head, rx_tail;
+
+static uint8_t ier;
+static int32_t serial_ready = 0;
+
+/* tx_fill
+ *
+ * DESCRIPTION: Moves up to a FIFO's worth of queued bytes into the UART,
+ *              then turns the transmit interrupt on or off depending on
+ *              whether anything is left. Called with interrupts off
+ * INPUT/OUTPUT: None
+ */
+static void tx_fill() {
+    int32_t i;
+
+    if (!(inb(COM1 + UART_LSR) & LSR_THRE)) return;
+
+    for (i = 0; i < TX_FIFO_SIZE && tx_tail != tx_head; i++) {
+        outb(tx_ring[tx_tail & TX_RING_MASK], COM1 + UART_DATA);
+        tx_tail++;
+    }
+
+    if (tx_tail != tx_head) ier |= IER_TX;
+    else ier &= ~IER_TX;
+    outb(ier, COM1 + UART_IER);
+}
+
+/* serial_init
+ *
+ * DESCRIPTION: Sets COM1 to 115200 8N1 with FIFOs and enables its IRQ
+ *
+ * INPUT/OUTPUT: None
+ * SIDE EFFECTS: Kernel printf output is mirrored to COM1 afterwards
+ */
+void serial_init() {
+    outb(0x00, COM1 + UART_IER);
+    outb(LCR_DLAB, COM1 + UART_LCR);
+    outb(BAUD_DIVISOR & 0xFF, COM1 + UART_DATA);
+    outb((BAUD_DIVISOR >> 8) & 0xFF, COM1 + UART_IER);
+    outb(LCR_8N1, COM1 + UART_LCR);
+    outb(FCR_ENABLE_CLEAR, COM1 + UART_FCR);
+    outb(MCR_DTR_RTS_OUT2, COM1 + UART_MCR);
+
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+
+    ier = IER_RX;
+    outb(ier, COM1 + UART_IER);
+    serial_ready = 1;
+
+    enable_irq(SERIAL_IRQ);
+}
+
+/* serial_handler
+ *
+ * DESCRIPTION: Drains the RX FIFO into the receive ring and refills the
+ *              TX FIFO from the transmit ring
+ *
+ * INPUT/OUTPUT: None
+ * SIDE EFFECTS: Sends end of interrupt signal
+ */
+void serial_handler() {
+    while (!(inb(COM1 + UART_IIR) & IIR_NONE)) {
+        while (inb(COM1 + UART_LSR) & LSR_DR) {
+            uint8_t c = inb(COM1 + UART_DATA);
+            /* Drop input when the reader has fallen behind */
+            if (rx_head - rx_tail < RX_RING_SIZE) {
+                rx_ring[rx_head & RX_RING_MASK] = c;
+                rx_head++;
+            }
+        }
+        tx_fill();
+    }
+    send_eoi(SERIAL_IRQ);
+}
+
+/* serial_putc
+ *
+ * DESCRIPTION: Queues a byte. When the ring is full the UART is fed by
+ *              polling, so this works with interrupts off and never drops
+ *
+ * INPUT: c - byte to send
+ * OUTPUT: None
+ */
+void serial_putc(uint8_t c) {
+    uint32_t flags;
+
+    if (!serial_ready) return;
+
+    cli_and_save(flags);
+    while (tx_head - tx_tail >= TX_RING_SIZE) {
+        tx_fill();
+    }
+    tx_ring[tx_head & TX_RING_MASK] = c;
+    tx_head++;
+    tx_fill();
+    restore_flags(flags);
+}
+
+/* serial_idle
+ *
+ * DESCRIPTION: Reports whether the transmit ring and the UART are empty.
+ *              Feeds the UART itself, so it can be polled with interrupts off
+ * OUTPUT: 1 when everything has been sent, 0 otherwise
+ */
+int32_t serial_idle(void) {
+    uint32_t flags;
+    int32_t idle;
+
+    cli_and_save(flags);
+    tx_fill();
+    idle = (tx_head == tx_tail) && (inb(COM1 + UART_LSR) & LSR_TEMT);
+    restore_flags(flags);
+    return idle;
+}
+
+/* serial_getline
+ *
+ * DESCRIPTION: Line discipline of the serial terminal. Waits for a full line
+ *              and returns it ending in '\n', like terminal_read. CR and
+ *              CRLF both end a line; a line longer than nbytes is cut short
+ *              and the rest of it discarded. Input is not echoed, so a host
+ *              can drive the shell through a pipe
+ *
+ * INPUT: buf - destination
+ *        nbytes - size of buf
+ * OUTPUT: Number of bytes read, -1 on bad arguments
+ */
+int32_t serial_getline(uint8_t* buf, int32_t nbytes) {
+    static int32_t last_cr = 0;
+    int32_t count = 0;
+    uint8_t c;
+
+    if (buf == NULL || nbytes <= 0) return -1;
+
+    while (1) {
+        while (rx_head == rx_tail) {
+            do_softirq();
+        }
+        c = rx_ring[rx_tail & RX_RING_MASK];
+        rx_tail++;
+
+        /* The LF of a CRLF pair was already handled by its CR */
+        if (c == '\n' && last_cr) {
+            last_cr = 0;
+            continue;
+        }
+        last_cr = (c == '\r');
+
+        if (c == '\r' || c == '\n') {
+            buf[count++] = '\n';
+            return count;
+        }
+        if (count < nbytes - 1) {
+            buf[count++] = c;
+        }
+    }
+}
+
+/* serial_read
+ *
+ * DESCRIPTION: Waits for input, then copies out what has arrived
+ *
+ * INPUT: buf - destination
+ *        nbytes - most bytes to copy
+ * OUTPUT: Number of bytes read
+ */
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes) {
+    int32_t count = 0;
+
+    if (buf == NULL || nbytes < 0) return -1;
+    if (nbytes == 0) return 0;
+
+    while (rx_head == rx_tail) {
+        do_softirq();
+    }
+
+    while (count < nbytes && rx_tail != rx_head) {
+        ((uint8_t*) buf)[count++] = rx_ring[rx_tail & RX_RING_MASK];
+        rx_tail++;
+    }
+    return count;
+}
+
+/* serial_write
+ *
+ * DESCRIPTION: Queues a buffer for transmission
+ *
+ * INPUT: buf - bytes to send
+ *        nbytes - number of bytes
+ * OUTPUT: Number of bytes written
+ */
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes) {
+    int32_t i;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    for (i = 0; i < nbytes; i++) {
+        serial_putc(((const uint8_t*) buf)[i]);
+    }
+    return nbytes;
+}
+
+/* serial_open
+ *
+ * DESCRIPTION: Nothing to set up, the port is initialized at boot
+ * OUTPUT: 0
+ */
+int32_t serial_open(const uint8_t* filename) {
+    return 0;
+}
+
+/* serial_close
+ *
+ * DESCRIPTION: Nothing to tear down
+ * OUTPUT: 0
+ */
+int32_t serial_close(int32_t fd) {
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* serial.h - 16550 UART driver for COM1
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _SERIAL_H
+#define _SERIAL_H
+#include "types.h"
+
+#define SERIAL_IRQ          0x04
+
+/* Mirror every terminal's console output to COM1. Off by default: COM1
+ * also carries the serial terminal's session and the trace batches */
+#ifndef SERIAL_LOG
+#define SERIAL_LOG          0
+#endif
+
+void serial_init();
+void serial_handler();
+
+/* Queue one byte for transmission, waiting for room if the ring is full */
+void serial_putc(uint8_t c);
+/* 1 once every queued byte has left the UART */
+int32_t serial_idle(void);
+/* Read one line of input for the serial terminal */
+int32_t serial_getline(uint8_t* buf, int32_t nbytes);
+
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t serial_open(const uint8_t* filename);
+int32_t serial_close(int32_t fd);
+
+#endif /* _SERIAL_H */
@@ -0,0 +1,128 @@
+/* simd.c - SSE2 copy and fill kernels behind memcpy and memset
+ * vim:ts=4 noexpandtab
+ *
+ * Only unprivileged instructions live here, so the hosted build can run
+ * these directly.
+ */
+
+#include "simd.h"
+#include "lib.h"
+
+/* The kernel is built without -msse, so gcc never keeps anything in xmm
+ * registers and refuses them as clobbers. A build that does use them (the
+ * hosted one) has to be told which ones the asm below overwrites */
+#ifdef __SSE__
+#define XMM_CLOBBERS        "xmm0", "xmm1", "xmm2", "xmm3",
+#else
+#define XMM_CLOBBERS
+#endif
+
+/* sse2_memcpy
+ *
+ * DESCRIPTION: Copies 64 bytes per iteration through xmm0-xmm3. Loads are
+ *              unaligned, stores aligned
+ * INPUTS: dest   - 16-byte aligned destination
+ *         src    - source, any alignment
+ *         n      - bytes, a multiple of 64
+ *         stream - nonzero for non-temporal stores that bypass the cache
+ * OUTPUTS: None
+ */
+void sse2_memcpy(void* dest, const void* src, uint32_t n, uint32_t stream) {
+    if (n == 0) return;
+
+    if (stream) {
+        asm volatile ("                     \n\
+                1:                          \n\
+                movdqu  (%1), %%xmm0        \n\
+                movdqu  16(%1), %%xmm1      \n\
+                movdqu  32(%1), %%xmm2      \n\
+                movdqu  48(%1), %%xmm3      \n\
+                movntdq %%xmm0, (%0)        \n\
+                movntdq %%xmm1, 16(%0)      \n\
+                movntdq %%xmm2, 32(%0)      \n\
+                movntdq %%xmm3, 48(%0)      \n\
+                add     $64, %0             \n\
+                add     $64, %1             \n\
+                sub     $64, %2             \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(dest), "+r"(src), "+r"(n)
+                :
+                : XMM_CLOBBERS "memory", "cc"
+        );
+    } else {
+        asm volatile ("                     \n\
+                1:                          \n\
+                movdqu  (%1), %%xmm0        \n\
+                movdqu  16(%1), %%xmm1      \n\
+                movdqu  32(%1), %%xmm2      \n\
+                movdqu  48(%1), %%xmm3      \n\
+                movdqa  %%xmm0, (%0)        \n\
+                movdqa  %%xmm1, 16(%0)      \n\
+                movdqa  %%xmm2, 32(%0)      \n\
+                movdqa  %%xmm3, 48(%0)      \n\
+                add     $64, %0             \n\
+                add     $64, %1             \n\
+                sub     $64, %2             \n\
+                jnz     1b                  \n\
+                "
+                : "+r"(dest), "+r"(src), "+r"(n)
+                :
+                : XMM_CLOBBERS "memory", "cc"
+        );
+    }
+}
+
+/* sse2_memset
+ *
+ * DESCRIPTION: Fills 64 bytes per iteration from xmm0
+ * INPUTS: dest   - 16-byte aligned destination
+ *         c      - fill byte
+ *         n      - bytes, a multiple of 64
+ *         stream - nonzero for non-temporal stores that bypass the cache
+ * OUTPUTS: None
+ */
+void sse2_memset(void* dest, uint8_t c, uint32_t n, uint32_t stream) {
+    uint32_t fill = c * WORD_ONES;
+
+    if (n == 0) return;
+
+    /* Both loops first broadcast the fill word to all of xmm0 */
+    if (stream) {
+        asm volatile ("                     \n\
+                movd    %2, %%xmm0          \n\
+                pshufd  $0, %%xmm0, %%xmm0  \n\
+                1:                          \n\
+                movntdq %%xmm0, (%0)        \n\
+                movntdq %%xmm0, 16(%0)      \n\
+                movntdq %%xmm0, 32(%0)      \n\
+                movntdq %%xmm0, 48(%0)      \n\
+                add     $64, %0             \n\
+                sub     $64, %1             \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(dest), "+r"(n)
+                : "r"(fill)
+                : XMM_CLOBBERS "memory", "cc"
+        );
+    } else {
+        asm volatile ("                     \n\
+                movd    %2, %%xmm0          \n\
+                pshufd  $0, %%xmm0, %%xmm0  \n\
+                1:                          \n\
+                movdqa  %%xmm0, (%0)        \n\
+                movdqa  %%xmm0, 16(%0)      \n\
+                movdqa  %%xmm0, 32(%0)      \n\
+                movdqa  %%xmm0, 48(%0)      \n\
+                add     $64, %0             \n\
+                sub     $64, %1             \n\
+                jnz     1b                  \n\
+                "
+                : "+r"(dest), "+r"(n)
+                : "r"(fill)
+                : XMM_CLOBBERS "memory", "cc"
+        );
+    }
+}
@@ -0,0 +1,23 @@
+/* simd.h - SSE2 copy and fill kernels behind memcpy and memset
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _SIMD_H
+#define _SIMD_H
+#include "types.h"
+
+/* memcpy/memset hand anything at least this long to the SSE2 kernels */
+#define SIMD_MIN_BYTES      256
+/* ... and use non-temporal stores from this size on. Copies that big would
+ * only push everything else out of the cache; for anything smaller the
+ * stores measured two to three times slower than cached ones */
+#define SIMD_STREAM_BYTES   (2 << 20)
+/* The kernels store to 16-byte aligned memory in blocks of 64 bytes */
+#define SIMD_ALIGN_MASK     0xF
+#define SIMD_BLOCK_MASK     0x3F
+
+/* SSE2 copy and fill kernels. dest must be 16-byte aligned and n a
+ * multiple of 64; must run inside kernel_fpu_begin/end */
+void sse2_memcpy(void* dest, const void* src, uint32_t n, uint32_t stream);
+void sse2_memset(void* dest, uint8_t c, uint32_t n, uint32_t stream);
+
+#endif /* _SIMD_H */
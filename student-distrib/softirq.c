@@ -0,0 +1,203 @@
+/* softirq.c - Deferred (bottom half) interrupt work
+ * vim:ts=4 noexpandtab
+ */
+
+#include "softirq.h"
+#include "lib.h"
+#include "trace.h"
+#include "profile.h"
+#include "syscalls.h"
+
+#define USER_RPL    0x3
+#define LINE_LEN    128
+#define NUM_LEN     16
+#define DEC         10
+
+typedef struct {
+    softirq_fn_t fn;    /* bottom half handler               */
+    uint32_t irq;       /* IRQ its running time is charged to */
+} softirq_t;
+
+static softirq_t softirq_vec[NUM_SOFTIRQS];
+static volatile uint32_t softirq_pending;
+
+irq_stats_t irq_stats[NUM_IRQS];
+
+/* open_softirq
+ *
+ * DESCRIPTION: Registers the bottom half for a deferred work vector
+ * INPUTS: nr  - softirq vector number
+ *         irq - IRQ line whose counters the work is charged to
+ *         fn  - handler to run
+ * OUTPUTS: None
+ */
+void open_softirq(uint32_t nr, uint32_t irq, softirq_fn_t fn) {
+    if (nr >= NUM_SOFTIRQS || irq >= NUM_IRQS) return;
+
+    softirq_vec[nr].fn = fn;
+    softirq_vec[nr].irq = irq;
+}
+
+/* raise_softirq
+ *
+ * DESCRIPTION: Marks a vector pending. Safe from both top halves and
+ *              process context
+ * INPUTS: nr - softirq vector number
+ * OUTPUTS: None
+ */
+void raise_softirq(uint32_t nr) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    softirq_pending |= (1 << nr);
+    restore_flags(flags);
+}
+
+/* do_softirq
+ *
+ * DESCRIPTION: Runs every pending bottom half with interrupts enabled.
+ *              Work raised meanwhile is picked up by a bounded number of
+ *              rescans; anything left waits for the next call
+ * INPUTS: None
+ * OUTPUTS: None
+ * SIDE EFFECTS: Handlers may switch tasks, so this may return on another
+ *               process' stack
+ */
+void do_softirq(void) {
+    uint32_t flags, nr, bit, restart;
+    uint64_t start;
+
+    cli_and_save(flags);
+    for (restart = 0; softirq_pending && restart < SOFTIRQ_MAX_RESTART; restart++) {
+        for (nr = 0; nr < NUM_SOFTIRQS; nr++) {
+            bit = 1 << nr;
+            if (!(softirq_pending & bit)) continue;
+
+            /* Clear before running so a handler can re-raise itself */
+            softirq_pending &= ~bit;
+            if (softirq_vec[nr].fn == NULL) continue;
+
+            sti();
+            start = rdtsc();
+            softirq_vec[nr].fn();
+            irq_stats[softirq_vec[nr].irq].bottom_cycles += rdtsc() - start;
+            cli();
+        }
+    }
+    restore_flags(flags);
+}
+
+/* irq_exit
+ *
+ * DESCRIPTION: Called by the IRQ linkage after the top half. Charges the
+ *              top half's time and, when the interrupt came from user mode,
+ *              runs pending bottom halves before the iret
+ * INPUTS: irq   - IRQ line that fired
+ *         cs    - code segment of the interrupted context
+ *         eip   - interrupted instruction, sampled by the profiler
+ *         start - time-stamp counter when the linkage was entered
+ * OUTPUTS: None
+ */
+void irq_exit(uint32_t irq, uint32_t cs, uint32_t eip, uint64_t start) {
+    irq_stats[irq].count++;
+    irq_stats[irq].top_cycles += rdtsc() - start;
+    TRACE(TRACE_IRQ_EXIT, irq);
+    if (profile_on) profile_sample(irq, eip);
+
+    if ((cs & USER_RPL) == USER_RPL && softirq_pending) {
+        do_softirq();
+    }
+}
+
+/* append
+ *
+ * DESCRIPTION: strcat for the line being built
+ */
+static void append(int8_t* line, const int8_t* s) {
+    strcpy(line + strlen(line), s);
+}
+
+/* irqstats_line
+ *
+ * DESCRIPTION: Formats one IRQ's counters, e.g.
+ *   IRQ1: 40 fired, top 900 cycles avg, bottom 15000 cycles avg
+ * OUTPUTS: length of the line, 0 for an IRQ that never fired
+ */
+static int32_t irqstats_line(uint32_t irq, int8_t* line) {
+    irq_stats_t* stat = &irq_stats[irq];
+    int8_t num[NUM_LEN];
+
+    line[0] = '\0';
+    if (stat->count == 0) return 0;
+
+    append(line, "IRQ");
+    append(line, itoa(irq, num, DEC));
+    append(line, ": ");
+    append(line, itoa(stat->count, num, DEC));
+    append(line, " fired, top ");
+    append(line, itoa((uint32_t)udiv64(stat->top_cycles, stat->count), num, DEC));
+    append(line, " cycles avg, bottom ");
+    append(line, itoa((uint32_t)udiv64(stat->bottom_cycles, stat->count), num, DEC));
+    append(line, " cycles avg\n");
+    return strlen(line);
+}
+
+/* irqstats_read
+ *
+ * DESCRIPTION: Returns as many whole lines as fit, continuing from the file
+ *              position on the next call
+ * OUTPUTS: bytes copied, 0 once every line has been read
+ */
+int32_t irqstats_read(int32_t fd, void* buf, int32_t nbytes) {
+    static int8_t line[LINE_LEN];
+    fd_t* file = &get_current_PCB()->file_array[fd];
+    int32_t len, count = 0;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    while (file->pos < NUM_IRQS) {
+        len = irqstats_line(file->pos, line);
+        if (count + len > nbytes) {
+            if (count != 0) break;
+            len = nbytes;
+        }
+        memcpy((uint8_t*)buf + count, line, len);
+        count += len;
+        file->pos++;
+    }
+    return count;
+}
+
+/* irqstats_write
+ *
+ * DESCRIPTION: "reset" clears every counter
+ * OUTPUTS: nbytes on success, -1 for anything else
+ */
+int32_t irqstats_write(int32_t fd, const void* buf, int32_t nbytes) {
+    uint32_t flags;
+
+    if (buf == NULL || nbytes < 5 || strncmp((const int8_t*)buf, "reset", 5)) return -1;
+
+    cli_and_save(flags);
+    memset(irq_stats, 0, sizeof(irq_stats));
+    restore_flags(flags);
+    return nbytes;
+}
+
+/* irqstats_open
+ *
+ * DESCRIPTION: Nothing to set up
+ * OUTPUT: 0
+ */
+int32_t irqstats_open(const uint8_t* filename) {
+    return 0;
+}
+
+/* irqstats_close
+ *
+ * DESCRIPTION: Nothing to tear down
+ * OUTPUT: 0
+ */
+int32_t irqstats_close(int32_t fd) {
+    return 0;
+}
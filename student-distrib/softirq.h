@@ -0,0 +1,47 @@
+/* softirq.h - Deferred (bottom half) interrupt work
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _SOFTIRQ_H
+#define _SOFTIRQ_H
+
+#include "types.h"
+
+#define NUM_IRQS            16
+
+/* Deferred work vectors, run in this order */
+#define SOFTIRQ_KEYBOARD    0
+#define SOFTIRQ_TIMER       1
+#define SOFTIRQ_TRACE       2
+#define NUM_SOFTIRQS        3
+
+/* How many times do_softirq rescans for work raised while it was running */
+#define SOFTIRQ_MAX_RESTART 4
+
+typedef void (*softirq_fn_t)(void);
+
+/* Per-IRQ accounting, in time-stamp counter cycles */
+typedef struct {
+    uint32_t count;          /* number of times the IRQ fired        */
+    uint64_t top_cycles;     /* time spent in the top half handler   */
+    uint64_t bottom_cycles;  /* time spent in the IRQ's deferred work */
+} irq_stats_t;
+
+extern irq_stats_t irq_stats[NUM_IRQS];
+
+/* Register the bottom half for a vector, charged to the given IRQ */
+void open_softirq(uint32_t nr, uint32_t irq, softirq_fn_t fn);
+/* Mark a vector's bottom half as pending */
+void raise_softirq(uint32_t nr);
+/* Run pending bottom halves with interrupts enabled */
+void do_softirq(void);
+/* Called by the IRQ linkage once the top half has returned */
+void irq_exit(uint32_t irq, uint32_t cs, uint32_t eip, uint64_t start);
+/* The "irqstats" device. Reading returns one line per IRQ that has fired;
+ * writing "reset" clears the counters */
+int32_t irqstats_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t irqstats_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t irqstats_open(const uint8_t* filename);
+int32_t irqstats_close(int32_t fd);
+
+#endif /* _SOFTIRQ_H */
@@ -5,6 +5,13 @@
 #include "lib.h"
 #include "x86_desc.h"
 #include "terminal.h"
+#include "serial.h"
+#include "trace.h"
+#include "profile.h"
+#include "sysstats.h"
+#include "softirq.h"
+#include "pipe.h"
+#include "sched.h"
 //#include "syscalls.S"
 
 #include "utils/arg_util.h"
@@ -36,7 +43,9 @@ fops_t fsys_funcs =
 	.read = file_read,
 	.write = file_write,
 	.open = file_open,
-	.close = file_close
+	.close = file_close,
+	.lseek = file_lseek,
+	.pread = file_pread
 };
 
 fops_t dir_funcs =
@@ -47,10 +56,64 @@ fops_t dir_funcs =
 	.close = dir_close
 };
 
+fops_t serial_funcs =
+{
+	.read = serial_read,
+	.write = serial_write,
+	.open = serial_open,
+	.close = serial_close
+};
+
+fops_t trace_funcs =
+{
+	.read = trace_read,
+	.write = trace_write,
+	.open = trace_open,
+	.close = trace_close
+};
+
+fops_t profile_funcs =
+{
+	.read = profile_read,
+	.write = profile_write,
+	.open = profile_open,
+	.close = profile_close
+};
+
+fops_t sysstats_funcs =
+{
+	.read = sysstats_read,
+	.write = sysstats_write,
+	.open = sysstats_open,
+	.close = sysstats_close
+};
+
+fops_t irqstats_funcs =
+{
+	.read = irqstats_read,
+	.write = irqstats_write,
+	.open = irqstats_open,
+	.close = irqstats_close
+};
+
+/* Devices opened by name instead of through the file system */
+static dev_t devices[] =
+{
+	{ (uint8_t*)"serial", &serial_funcs },
+	{ (uint8_t*)"trace", &trace_funcs },
+	{ (uint8_t*)"profile", &profile_funcs },
+	{ (uint8_t*)"sysstats", &sysstats_funcs },
+	{ (uint8_t*)"irqstats", &irqstats_funcs }
+};
+
+#define NUM_NAMED_DEVICES (sizeof(devices) / sizeof(devices[0]))
+
 static int32_t procs[MAX_DEVICES] = {0};
 
 uint8_t command_arguments[MAX_BUFF_LENGTH];
-uint8_t vidmap_called = 0;
+
+/* Off-screen text buffers for vidmap_buffered, one page per process */
+static uint16_t vid_back[MAX_DEVICES][PAGE_SIZE_KB / 2] __attribute__((aligned (PAGE_SIZE_KB)));
 
 /*
 * add_process()
@@ -80,6 +143,7 @@ int32_t add_process(){
 			/* If processindex is available, return the index */
         if(procs[i] == 0){
             procs[i] = 1;
+			proc_state[i] = PROC_RUNNABLE;
 			process_count++;
 			running_procs[running_terminal] = i;
 			term_procs[i] = running_terminal;
@@ -103,13 +167,63 @@ int32_t delete_process(int32_t pid){
 
 	/* Free space for process pid */
     procs[pid] = 0;
-	remove_term_process(pid);
+	proc_state[pid] = PROC_FREE;
 	process_count--;
-	running_procs[display_terminal] = find_PCB(pid)->par_p_id;
+	running_procs[term_procs[pid]] = find_PCB(pid)->par_p_id;
+	fpu_exit(pid);
+	remove_term_process(pid);
 	term_procs[pid] = -1;
     return 0;
 }
 
+/*
+* clear_fd(fd_t* fd)
+* DESCRIPTION: Marks a file array entry unused
+* INPUTS: fd - the entry
+* OUTPUT: None
+*/
+static void clear_fd(fd_t* fd)
+{
+	int32_t i;
+
+	fd->fops = NULL;
+	fd->pos = 0;
+	fd->flags = 0;
+	for (i = 0; i < FNAME_MAX_LEN; i++) {
+		fd->file_name[i] = '\0';
+	}
+}
+
+/*
+* release_fd(int32_t fd)
+* DESCRIPTION: Closes a descriptor of the current process whatever its
+*              driver returns, stdin and stdout included, for halt and dup2
+* INPUTS: fd - descriptor, open or not
+* OUTPUT: None
+*/
+static void release_fd(int32_t fd)
+{
+	pcb_t* curr = get_current_PCB();
+
+	if (curr->file_array[fd].flags == 0) return;
+	curr->file_array[fd].fops->close(fd);
+	clear_fd(&curr->file_array[fd]);
+}
+
+/*
+* copy_fd(fd_t* dest, const fd_t* source)
+* DESCRIPTION: Copies a descriptor for dup2 and execute. A pipe end counts
+*              its copies; a file's copy gets its own position
+* INPUTS: dest   - unused entry to fill in
+*         source - open descriptor
+* OUTPUT: None
+*/
+static void copy_fd(fd_t* dest, const fd_t* source)
+{
+	*dest = *source;
+	if (is_pipe(source)) pipe_dup(source);
+}
+
 
 // TA_Q: When Halt is called, how do we know which process should be halted?
 //         Example: Terminal 2 is running Shell and another Shell and
@@ -139,9 +253,25 @@ int32_t halt (uint8_t status)
 	uint32_t ebp;
 	uint32_t i;
 	uint32_t physical_addr;
+	uint32_t term;
 
 	/* Restore parent data */
 	pcb_child_ptr = get_current_PCB();
+	TRACE(TRACE_HALT, status);
+
+	/* Close all the files in the pcb, while it is still the current process */
+	for(i = 0; i < FILE_ARRAY_LEN; i++)
+	{
+		release_fd(i);
+	}
+
+	/* Nobody waits in execute for a process that ran alongside its parent */
+	if (pcb_child_ptr->detached) {
+		term = term_procs[pcb_child_ptr->p_id];
+		delete_process(pcb_child_ptr->p_id);
+		sched_exit(pcb_child_ptr->p_id, term);
+		return 0; // Shouldn't be called
+	}
 
 	/* Setting parent ptr, if it exists */
 	if (pcb_child_ptr->par_p_id >= 0) {
@@ -159,6 +289,7 @@ int32_t halt (uint8_t status)
 		esp = pcb_parent_ptr->esp;
 		ebp = pcb_parent_ptr->ebp;
 		delete_process(pcb_child_ptr->p_id);
+		proc_state[pcb_parent_ptr->p_id] = PROC_RUNNABLE;
 	} else {
 		delete_process(pcb_child_ptr->p_id);
 		asm volatile("           		  	\n\
@@ -172,22 +303,14 @@ int32_t halt (uint8_t status)
 		return 0; // Shouldn't be called
 	}
 
-	/* Close all the files in the pcb */
-	for(i = 0; i < FILE_ARRAY_LEN; i++)
+	/* Give user video memory back to the parent, or unmap it */
+	if (pcb_parent_ptr != NULL)
 	{
-		if (pcb_child_ptr->file_array[i].flags == 1)
-		{
-			close(i);
-		}
-		pcb_child_ptr->file_array[i].fops = NULL;
-		pcb_child_ptr->file_array[i].flags = 0;
+		remap_vidmap(pcb_parent_ptr->p_id);
 	}
-
-	/* Unmap if vidmap was called */
-	if(vidmap_called)
+	else
 	{
-		/* Unmap 4kb page from user video memory */
-		map_v_p(USER_VIDMAP, 0, 0, 1, 1);
+		remap_vidmap(-1);
 	}
 
 	putc('\n');
@@ -210,25 +333,107 @@ int32_t halt (uint8_t status)
 	return 0; // Shouldn't be called
 }
 
+/*
+* push_user_args(pcb_t* pcb, uint32_t stack)
+* DESCRIPTION: Lays out main()'s arguments at the top of a new process'
+*              user stack. From the returned stack pointer up: argc, argv,
+*              the NULL terminated argv array, then the words themselves
+* INPUTS: pcb   -- the new process, with its command line parsed
+*         stack -- top of its user stack, already mapped
+* OUTPUT: returns the stack pointer to start the process with
+*/
+static uint32_t push_user_args(pcb_t* pcb, uint32_t stack)
+{
+	uint32_t strings_size;
+	uint32_t* sp;
+	uint8_t* str;
+	int32_t i;
+
+	/* Every word gets a terminator */
+	strings_size = 0;
+	for (i = 0; i < pcb->argc; i++) strings_size += pcb->argv[i].length + 1;
+
+	str = (uint8_t*)((stack - strings_size) & ~WORD_MASK);
+	sp = (uint32_t*)str - (pcb->argc + 1) - 2;
+	sp[0] = pcb->argc;
+	sp[1] = (uint32_t)(sp + 2);
+	for (i = 0; i < pcb->argc; i++) {
+		sp[2 + i] = (uint32_t)str;
+		memcpy(str, pcb->arg_buffer + pcb->argv[i].offset, pcb->argv[i].length);
+		str[pcb->argv[i].length] = '\0';
+		str += pcb->argv[i].length + 1;
+	}
+	sp[2 + pcb->argc] = 0;
+	return (uint32_t)sp;
+}
+
+/*
+* init_pcb(pcb_t* pcb, int32_t p_id, int32_t par_p_id)
+* DESCRIPTION: Resets every field of a new process' PCB. stdin and stdout
+*              are copies of the parent's, which it may have pointed at
+*              pipes with dup2, else the terminal; all else starts closed,
+*              unmapped and with a clean FPU
+* INPUTS: pcb      -- the PCB of a process add_process just handed out
+*         p_id     -- its process id
+*         par_p_id -- its parent, or -1
+* OUTPUT: None
+*/
+void init_pcb(pcb_t* pcb, int32_t p_id, int32_t par_p_id)
+{
+	int32_t i;
+
+	for(i = 0; i < FILE_ARRAY_LEN; i++)
+	{
+		clear_fd(&pcb->file_array[i]);
+		pcb->file_array[i].inode = NULL;
+	}
+	for(i = 0; i < 2; i++)
+	{
+		if(par_p_id >= 0 && find_PCB(par_p_id)->file_array[i].flags)
+		{
+			copy_fd(&pcb->file_array[i], &find_PCB(par_p_id)->file_array[i]);
+		}
+		else
+		{
+			pcb->file_array[i].fops = &terminal_funcs;
+			pcb->file_array[i].flags = 1;
+		}
+	}
+
+	pcb->arg_length = 0;
+	pcb->argc = 0;
+	pcb->p_id = p_id;
+	pcb->par_p_id = par_p_id;
+	pcb->esp = 0;
+	pcb->ebp = 0;
+	pcb->vidmap = 0;
+	pcb->fpu_used = 0;
+	pcb->detached = 0;
+	pcb->start_eip = 0;
+	pcb->start_esp = 0;
+}
+
 int32_t execute (const uint8_t* all_arguments)
 {
 	pcb_t* pcb;
 	uint8_t all_arguments_copy[MAX_BUFF_LENGTH];
-	int32_t command_length, process_id, parent_process_id, i, output;
-	uint32_t virtual_stack_addr, physical_addr;
+	arg_t argv[MAX_ARGS];
+	int32_t command_length, arg_length, argc, process_id, parent_process_id, i, output;
+	uint32_t virtual_stack_addr, physical_addr, entry;
 	dentry_t dentry;
-	fd_t stdin;
-	fd_t stdout;
 
+	arg_length = string_length(all_arguments);
+	if (arg_length < 0 || arg_length >= MAX_BUFF_LENGTH) return -1;
 	copy_string(all_arguments, all_arguments_copy);
 
-	/* Get first word (command) */
-	command_length = get_argument_length(all_arguments_copy, 0);
-	if (command_length < 0) return 0;  // Error getting first word
+	/* Split the command line once; the first word is the command */
+	argc = parse_arguments(all_arguments_copy, argv, MAX_ARGS);
+	if (argc <= 0) return 0;  // Error getting first word
+	command_length = argv[0].length;
 
 	uint8_t executable[command_length + 1];
+	memcpy(executable, all_arguments_copy + argv[0].offset, command_length);
 	executable[command_length] = '\0';  // Make it a string by adding EOS
-	if (get_argument(all_arguments_copy, 0, executable) < 0) return 0;  // Error copying argument
 
 	/* Check that command is an executable */
 	if (!is_executable(executable)) return -1;
@@ -246,9 +451,13 @@ int32_t execute (const uint8_t* all_arguments)
 
 	/* Create next PCB */
 	pcb = (pcb_t*)((KERNEL_MEMORY_ADDR + MB_4) - (process_id + 1) * PCB_SIZE);
+	init_pcb(pcb, process_id, parent_process_id);
 
-	/* Save extra parameters to global variable, stripped of leading spaces */
-	get_next_arguments(all_arguments_copy, pcb->arg_buffer);
+	/* Keep the parsed command line for getargs and the user stack */
+	memcpy(pcb->arg_buffer, all_arguments_copy, arg_length + 1);
+	memcpy(pcb->argv, argv, argc * sizeof(arg_t));
+	pcb->arg_length = arg_length;
+	pcb->argc = argc;
 
 	/* Need to double check the values i the below formulas */
 	physical_addr = USER_PROCESS_START_PHYSICAL + process_id * USER_PROCESS_SIZE;
@@ -263,6 +472,9 @@ int32_t execute (const uint8_t* all_arguments)
 	read_dentry_by_name(executable, &dentry);
 	read_file_bytes_by_name(executable, (uint8_t*)(USER_PROCESS_START_VIRTUAL + USER_PROCESS_IMAGE_OFFSET), file_size(executable));
 
+	/* main(argc, argv) finds its arguments at the top of the user stack */
+	virtual_stack_addr = push_user_args(pcb, virtual_stack_addr);
+
 	/* Create eip_buf to put into EIP location in asm */
 	uint32_t* eip_ptr = (uint32_t*)(USER_PROCESS_START_VIRTUAL + USER_PROCESS_IMAGE_OFFSET + ELF_OFFSET);
 	uint8_t eip_buf[4];
@@ -270,37 +482,30 @@ int32_t execute (const uint8_t* all_arguments)
 	{
   		eip_buf[i] = *(uint8_t*)(USER_PROCESS_START_VIRTUAL + USER_PROCESS_IMAGE_OFFSET + ELF_OFFSET + 3 - i);
 	}
-
-	/* Set fd = 0 and fd = 1 in file_array */
-	stdin.fops = &terminal_funcs;
-	stdin.inode = NULL;
-	stdin.pos = 0;
-	stdin.flags = 1;
-	pcb->file_array[0] = stdin;
-
-	stdout.fops = &terminal_funcs;
-	stdout.inode = NULL;
-	stdout.pos = 0;
-	stdout.flags = 1;
-	pcb->file_array[1] = stdout;
-
-
-	/* Initialize remaining file array */
-	for(i = 2; i < FILE_ARRAY_LEN; i++)
-	{
-		pcb->file_array[i].fops = NULL;
-		pcb->file_array[i].inode = NULL;
-		pcb->file_array[i].pos = 0;
-		pcb->file_array[i].flags = 0;
+	entry = *eip_ptr;
+
+	TRACE(TRACE_EXECUTE, process_id);
+	profile_exec(process_id, executable);
+
+	/* A stage writing into a pipe runs alongside its parent, which reads */
+	/* the pipe or starts the next stage; the scheduler starts it later   */
+	if (is_pipe(&pcb->file_array[1])) {
+		pcb->detached = 1;
+		pcb->start_eip = entry;
+		pcb->start_esp = virtual_stack_addr;
+		running_procs[running_terminal] = parent_process_id;
+		map_v_p(USER_PROCESS_START_VIRTUAL, USER_PROCESS_START_PHYSICAL + parent_process_id * USER_PROCESS_SIZE, 1, 1, 1);
+		flush_tlb();
+		return 0;
 	}
 
-	/* Update PCB values */
-	pcb->p_id = process_id;
-	pcb->par_p_id = parent_process_id;
+	remap_vidmap(process_id);
+	fpu_switch();
 
 	tss.esp0 = (KERNEL_MEMORY_ADDR + MB_4) - (process_id) * PCB_SIZE - 4;
 	tss.ss0 = KERNEL_DS;
 	if (parent_process_id >= 0) {
+		proc_state[parent_process_id] = PROC_WAITING;
 		asm volatile ("                               \n\
 			movl %%esp, %0                            \n\
 			movl %%ebp, %1                            \n\
@@ -311,24 +516,7 @@ int32_t execute (const uint8_t* all_arguments)
 		);
 	}
 
-
-	asm volatile("          				\n\
-		mov    $0x2B, %%ax                  \n\
-		mov    %%ax, %%ds                   \n\
-		pushl	$0x2B						\n\
-		pushl	%3							\n\
-		pushfl								\n\
-		popl    %%eax 						\n\
-		orl     $0x200, %%eax				\n\
-		pushl   %%eax 						\n\
-		pushl	$0x23						\n\
-		pushl	%2							\n\
-		iret								\n\
-		"
-		:
-		: "r"(USER_DS), "r"(USER_CS), "r"(*(uint32_t*)(eip_ptr)), "r"(virtual_stack_addr)//, "r"(), "r"()
-		: "cc", "memory"
-	);
+	enter_user(entry, virtual_stack_addr);
 
 	asm volatile ("	\n\
 		exec_ret:							\n\
@@ -339,13 +527,41 @@ int32_t execute (const uint8_t* all_arguments)
 	:
 	: "cc", "memory"
 	);
-	if (running_procs[display_terminal] < 0) {
+	if (running_procs[running_terminal] < 0) {
 		printf("Haha! Nice try. Restarting shell...\n");
 		execute(dechar("shell"));
 	}
 	return output;
 }
 
+/*
+* enter_user(uint32_t eip, uint32_t esp)
+* DESCRIPTION: Drops to user mode with interrupts on, for execute and for
+*              the first time slice of a process started alongside its parent
+* INPUTS: eip -- first instruction
+*         esp -- user stack pointer
+* OUTPUT: does not return
+*/
+void enter_user(uint32_t eip, uint32_t esp)
+{
+	asm volatile("          				\n\
+		mov    $0x2B, %%ax                  \n\
+		mov    %%ax, %%ds                   \n\
+		pushl	$0x2B						\n\
+		pushl	%1							\n\
+		pushfl								\n\
+		popl    %%eax 						\n\
+		orl     $0x200, %%eax				\n\
+		pushl   %%eax 						\n\
+		pushl	$0x23						\n\
+		pushl	%0							\n\
+		iret								\n\
+		"
+		:
+		: "r"(eip), "r"(esp)
+		: "eax", "cc", "memory"
+	);
+}
 
 /*
 * int32_t read(int32_t fd, const uint8_t * buf, int32_t nbytes);
@@ -450,6 +666,23 @@ int32_t open(const uint8_t* filename)
 		// Get pointer to the current file_array
     fd_ptr = &(pcb->file_array[fd]);
 
+		/* Named devices take precedence over the file system */
+		for(index = 0; index < NUM_NAMED_DEVICES; index++)
+		{
+				if(string_equal(filename, devices[index].name) == 1)
+				{
+						if(devices[index].fops->open(filename) != 0)
+						{
+								return -1;
+						}
+						fd_ptr->inode = NULL;
+						fd_ptr->pos = 0;
+						fd_ptr->flags = 1;
+						fd_ptr->fops = devices[index].fops;
+						return fd;
+				}
+		}
+
 		/* Get dentry based on filename */
     if(read_dentry_by_name(filename, &dentry) == -1)
 		{
@@ -519,19 +752,286 @@ int32_t close(int32_t fd)
 		{
         return -1;
     }
-	// char nol = '/0';
 		/* Re-set file with default values */
-    curr->file_array[fd].fops = NULL;
-    curr->file_array[fd].pos = 0;
-    curr->file_array[fd].flags = 0;
-	int i;
-	for (i = 0; i < FNAME_MAX_LEN; i++){
-		curr->file_array[(uint32_t)fd].file_name[(uint32_t)i] = NULL;
-		/* Return 0 on success */}
+    clear_fd(&curr->file_array[fd]);
 
+		/* Return 0 on success */
     return 0;
 }
 
+/*
+* int32_t pipe(int32_t* fds);
+* DESCRIPTION: Makes a pipe, with both ends in the lowest free descriptors
+* INPUTS: fds - gets the read end in fds[0] and the write end in fds[1]
+* OUTPUT: Return -1 on fail, 0 on success
+*/
+int32_t pipe(int32_t* fds)
+{
+	pcb_t* pcb = get_current_PCB();
+	int32_t read_fd = -1, write_fd = -1;
+	uint32_t index;
+
+	if(fds == NULL)
+	{
+		return -1;
+	}
+
+	for(index = MIN_FD; index < FILE_ARRAY_LEN; index++)
+	{
+		if(pcb->file_array[index].flags != 0) continue;
+		if(read_fd < 0)
+		{
+			read_fd = index;
+		}
+		else
+		{
+			write_fd = index;
+			break;
+		}
+	}
+	if(write_fd < 0)
+	{
+		return -1;
+	}
+
+	if(pipe_alloc(&pcb->file_array[read_fd], &pcb->file_array[write_fd]) != 0)
+	{
+		return -1;
+	}
+	fds[0] = read_fd;
+	fds[1] = write_fd;
+	return 0;
+}
+
+/*
+* int32_t dup2(int32_t oldfd, int32_t newfd);
+* DESCRIPTION: Makes newfd refer to what oldfd does, closing what newfd had
+*              open first. This is how a process points its stdin or stdout
+*              at a pipe before executing a child, which inherits both
+* INPUTS: oldfd - open descriptor
+*         newfd - descriptor to replace, 0 and 1 included
+* OUTPUT: Return -1 on fail, newfd on success
+*/
+int32_t dup2(int32_t oldfd, int32_t newfd)
+{
+	pcb_t* pcb = get_current_PCB();
+
+	if(oldfd < 0 || oldfd > MAX_FD || newfd < 0 || newfd > MAX_FD
+		|| pcb->file_array[oldfd].flags == 0)
+	{
+		return -1;
+	}
+	if(oldfd == newfd)
+	{
+		return newfd;
+	}
+
+	release_fd(newfd);
+	copy_fd(&pcb->file_array[newfd], &pcb->file_array[oldfd]);
+	return newfd;
+}
+
+/*
+* int32_t sendfile(int32_t out_fd, int32_t in_fd, int32_t nbytes);
+* DESCRIPTION: Streams in_fd to out_fd inside the kernel until end of file
+*              or nbytes. A file's data blocks go straight from the image to
+*              the output's write, so the terminal renders them or a pipe
+*              takes them with a single copy. Other sources go through a
+*              small buffer on the kernel stack
+* INPUTS: out_fd - open descriptor to write
+*         in_fd  - open descriptor to read, advanced past what was sent
+*         nbytes - most bytes to send
+* OUTPUT: Return -1 on fail, else the number of bytes sent
+*/
+int32_t sendfile(int32_t out_fd, int32_t in_fd, int32_t nbytes)
+{
+	pcb_t* pcb = get_current_PCB();
+	fd_t* in;
+	fd_t* out;
+	const uint8_t* span;
+	uint8_t bounce[SENDFILE_CHUNK];
+	int32_t sent, count, written;
+
+	if(out_fd < 0 || out_fd > MAX_FD || in_fd < 0 || in_fd > MAX_FD || nbytes < 0
+		|| pcb->file_array[out_fd].flags == 0 || pcb->file_array[in_fd].flags == 0)
+	{
+		return -1;
+	}
+	in = &pcb->file_array[in_fd];
+	out = &pcb->file_array[out_fd];
+
+	for(sent = 0; sent < nbytes; sent += written)
+	{
+		if(in->fops == &fsys_funcs)
+		{
+			count = data_span(in->inode, in->pos, &span);
+		}
+		else
+		{
+			count = (nbytes - sent < SENDFILE_CHUNK) ? nbytes - sent : SENDFILE_CHUNK;
+			count = in->fops->read(in_fd, bounce, count);
+			span = bounce;
+		}
+		if(count <= 0)
+		{
+			/* End of file, or a failed read after some bytes went out */
+			if(count < 0 && sent == 0) return -1;
+			break;
+		}
+		if(count > nbytes - sent) count = nbytes - sent;
+
+		written = out->fops->write(out_fd, span, count);
+		if(written <= 0)
+		{
+			if(sent == 0) return -1;
+			break;
+		}
+		if(in->fops == &fsys_funcs) in->pos += written;
+		if(written < count) return sent + written;
+	}
+	return sent;
+}
+
+/*
+* int32_t getdents(int32_t fd, void* buf, int32_t nbytes);
+* DESCRIPTION: Fills buf with as many dirent_t records (name, type, inode,
+*              size) as fit, continuing from the descriptor's place in the
+*              directory, so a listing takes a call or two instead of a
+*              read and a stat per name
+* INPUTS: fd     - descriptor open on a directory
+*         buf    - record buffer
+*         nbytes - size of buf, at least one record
+* OUTPUT: Return -1 on fail, else the bytes filled, 0 at end of directory
+*/
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes)
+{
+	pcb_t* pcb = get_current_PCB();
+	int32_t count;
+
+	if(fd < 0 || fd > MAX_FD || buf == NULL || nbytes < (int32_t)sizeof(dirent_t)
+		|| pcb->file_array[fd].flags == 0 || pcb->file_array[fd].fops != &dir_funcs)
+	{
+		return -1;
+	}
+
+	count = read_dirents(&pcb->file_array[fd].pos, buf, nbytes / sizeof(dirent_t));
+	if(count < 0) return -1;
+	return count * sizeof(dirent_t);
+}
+
+/*
+* int32_t stat(const uint8_t* filename, stat_t* buf);
+* DESCRIPTION: Describes a file by name without opening or reading it:
+*              type, inode, size and data blocks, from the inode metadata
+*              init_filesys cached
+* INPUTS: filename - file system or named device
+*         buf      - where to put the description
+* OUTPUT: Return -1 on fail, else 0
+*/
+int32_t stat(const uint8_t* filename, stat_t* buf)
+{
+	dentry_t dentry;
+	uint32_t index;
+
+	if(filename == NULL || buf == NULL || string_length(filename) > FNAME_MAX_LEN)
+	{
+		return -1;
+	}
+
+	for(index = 0; index < NUM_NAMED_DEVICES; index++)
+	{
+		if(string_equal(filename, devices[index].name) == 1)
+		{
+			memset(buf, 0, sizeof(stat_t));
+			buf->file_type = FILE_TYPE_DEVICE;
+			return 0;
+		}
+	}
+
+	if(read_dentry_by_name(filename, &dentry) == -1) return -1;
+	return stat_dentry(&dentry, buf);
+}
+
+/*
+* int32_t fstat(int32_t fd, stat_t* buf);
+* DESCRIPTION: Describes what an open descriptor refers to, as stat does.
+*              The terminal, pipes and named devices are FILE_TYPE_DEVICE
+* INPUTS: fd  - open descriptor
+*         buf - where to put the description
+* OUTPUT: Return -1 on fail, else 0
+*/
+int32_t fstat(int32_t fd, stat_t* buf)
+{
+	pcb_t* pcb = get_current_PCB();
+	fd_t* file;
+
+	if(fd < 0 || fd > MAX_FD || buf == NULL || pcb->file_array[fd].flags == 0)
+	{
+		return -1;
+	}
+	file = &pcb->file_array[fd];
+
+	if(file->fops == &fsys_funcs) return stat_inode(file->inode, buf);
+
+	memset(buf, 0, sizeof(stat_t));
+	if(file->fops == &dir_funcs)
+	{
+		buf->file_type = FILE_TYPE_DIR;
+	}
+	else if(file->fops == &rtc_funcs)
+	{
+		buf->file_type = FILE_TYPE_RTC;
+	}
+	else
+	{
+		buf->file_type = FILE_TYPE_DEVICE;
+	}
+	return 0;
+}
+
+/*
+* int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
+* DESCRIPTION: Moves where the next read of a descriptor starts, so a
+*              program can go straight to the part of a file it wants
+* INPUTS: fd     - open descriptor that can seek (a regular file)
+*         offset - bytes to move
+*         whence - SEEK_SET, SEEK_CUR or SEEK_END
+* OUTPUT: Return -1 on fail, else the new position
+*/
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+	pcb_t* pcb = get_current_PCB();
+
+	if(fd < 0 || fd > MAX_FD || pcb->file_array[fd].flags == 0
+		|| pcb->file_array[fd].fops->lseek == NULL)
+	{
+		return -1;
+	}
+	return pcb->file_array[fd].fops->lseek(fd, offset, whence);
+}
+
+/*
+* int32_t pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+* DESCRIPTION: Reads nbytes at offset without moving the descriptor's
+*              position. The fourth argument comes in esi
+* INPUTS: fd     - open descriptor that can seek (a regular file)
+*         buf    - destination
+*         nbytes - most bytes to read
+*         offset - byte offset within the file
+* OUTPUT: Return -1 on fail, else the number of bytes read
+*/
+int32_t pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset)
+{
+	pcb_t* pcb = get_current_PCB();
+
+	if(fd < 0 || fd > MAX_FD || buf == NULL || pcb->file_array[fd].flags == 0
+		|| pcb->file_array[fd].fops->pread == NULL)
+	{
+		return -1;
+	}
+	return pcb->file_array[fd].fops->pread(fd, buf, nbytes, offset);
+}
+
 /* getargs
  * DESCRIPTION: Put the command arguments from the user program into a buffer
  * INPUTS: buf    -- a buffer in which to put the bytes
@@ -544,14 +1044,16 @@ int32_t close(int32_t fd)
 int32_t getargs (uint8_t* buf, uint32_t nbytes)
 {
 	pcb_t* pcb = get_current_PCB();
-	/* pcb->arg_buffer must have EOS */
-	if ((string_length(pcb->arg_buffer) + 1) > nbytes ||(pcb->arg_buffer == NULL) || buf == NULL || string_length(pcb->arg_buffer) == 0) return -1;
-	copy_string(pcb->arg_buffer, buf);
-	/* another option... */
-	// copy_buf(pcb->arg_buffer, buf, nbytes);
-	printf("getargs buf: %s\n", buf);
-	// clear buffer
+	uint32_t start, length;
+
+	/* Everything after the command, as parsed by execute */
+	if (buf == NULL || pcb->argc < 2) return -1;
+	start = pcb->argv[1].offset;
+	length = pcb->arg_length - start;
+	if (length + 1 > nbytes) return -1;
 
+	memcpy(buf, pcb->arg_buffer + start, length);
+	buf[length] = '\0';
 	return 0;
 }
 
@@ -606,16 +1108,118 @@ int32_t vidmap (uint8_t** screen_start)
 		return -1;
 	}
 
-	vidmap_called = 1;
-
-	/* Map 4kb page from user memory, point it to physical video memory */
-	map_v_p(USER_VIDMAP, VIDEO, 0, 1, 1);
+	/* Map 4kb page from user memory to this terminal's video page */
+	get_current_PCB()->vidmap |= VIDMAP_DIRECT;
+	remap_vidmap(get_current_PCB()->p_id);
 
 	// Set screen start to 64 MB
 	*screen_start = (uint8_t*)(USER_VIDMAP);
 	return USER_VIDMAP;
 }
 
+/*
+* int32_t vidmap_buffered (uint8_t** screen_start);
+* DESCRIPTION:  Maps an off-screen copy of the text screen into user space.
+*               Drawing there touches no video memory until present is called
+* INPUTS: screen start - Pointer to start os user video memory
+* OUTPUT: Return -1 on fail,return virtual address on success
+* SIDE EFFECTS: Fills the buffer with what the terminal currently shows
+*/
+int32_t vidmap_buffered (uint8_t** screen_start)
+{
+	pcb_t* pcb = get_current_PCB();
+
+	/* Same checks as vidmap */
+	if(screen_start == NULL)
+	{
+		return -1;
+	}
+	if((uint32_t)screen_start < (USER_PROCESS_START_VIRTUAL + USER_PROCESS_IMAGE_OFFSET)
+	 	|| (uint32_t)screen_start >= (USER_PROCESS_START_VIRTUAL + MB_4))
+	{
+		return -1;
+	}
+
+	/* Start from the visible contents so the first present writes nothing */
+	memcpy(vid_back[pcb->p_id], (void*)get_term_vid_addr(term_procs[pcb->p_id]), NUM_ROWS * NUM_COLS * 2);
+
+	pcb->vidmap |= VIDMAP_BUFFERED;
+	remap_vidmap(pcb->p_id);
+
+	*screen_start = (uint8_t*)(USER_VIDMAP_BUFFERED);
+	return USER_VIDMAP_BUFFERED;
+}
+
+/*
+* int32_t present (void);
+* DESCRIPTION:  Copies the back buffer to the terminal's video page. Two cells
+*               are compared at a time and only the pairs that changed are
+*               written, so a mostly static frame costs a few VGA writes
+* INPUTS: none
+* OUTPUT: Return -1 if vidmap_buffered was not called, else the number of
+*         cell pairs written
+* SIDE EFFECTS: Writes to video memory
+*/
+int32_t present (void)
+{
+	pcb_t* pcb = get_current_PCB();
+	uint32_t* back;
+	volatile uint32_t* front;
+	int32_t i, written = 0;
+
+	if(!(pcb->vidmap & VIDMAP_BUFFERED))
+	{
+		return -1;
+	}
+
+	back = (uint32_t*)vid_back[pcb->p_id];
+	front = (volatile uint32_t*)get_term_vid_addr(term_procs[pcb->p_id]);
+
+	/* NUM_COLS is even, so the screen is a whole number of cell pairs */
+	for(i = 0; i < (NUM_ROWS * NUM_COLS) / 2; i++)
+	{
+		if(front[i] != back[i])
+		{
+			front[i] = back[i];
+			written++;
+		}
+	}
+	return written;
+}
+
+/*
+* void remap_vidmap(int32_t p_id);
+* DESCRIPTION:  Points the user video page at the video memory of the terminal
+*               the process runs on, and the buffered page at its back buffer.
+*               Every terminal owns a VGA page, so the process keeps drawing at
+*               full rate while it is in the background
+* INPUTS: p_id - process whose mappings should be installed
+* OUTPUT: none
+* SIDE EFFECTS: Changes the USER_VIDMAP and USER_VIDMAP_BUFFERED page table entries
+*/
+void remap_vidmap(int32_t p_id)
+{
+	uint32_t flags = (p_id >= 0) ? find_PCB(p_id)->vidmap : 0;
+
+	if (flags & VIDMAP_DIRECT)
+	{
+		map_v_p(USER_VIDMAP, get_term_vid_addr(term_procs[p_id]), 0, 1, 1);
+	}
+	else
+	{
+		map_v_p(USER_VIDMAP, 0, 0, 1, 1);
+	}
+
+	if (flags & VIDMAP_BUFFERED)
+	{
+		map_v_p(USER_VIDMAP_BUFFERED, (uint32_t)vid_back[p_id], 0, 1, 1);
+	}
+	else
+	{
+		map_v_p(USER_VIDMAP_BUFFERED, 0, 0, 1, 1);
+	}
+}
+
 /*
 * int32_t set_handler (int32_t signum, void* handler_address);
 * DESCRIPTION: Sets a given signal to be handled by given handler
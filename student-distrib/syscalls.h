@@ -7,6 +7,8 @@ extern void jump_userspace(void);
 #include "rtc.h"
 #include "terminal.h"
 #include "lib.h"
+#include "fpu.h"
+#include "utils/arg_util.h"
 
 #define MIN_FD 					2
 #define MAX_FD 					7
@@ -24,6 +26,19 @@ extern void jump_userspace(void);
 #define USER_PROCESS_STACK            USER_PROCESS_START_VIRTUAL + USER_PROCESS_SIZE - 0x4
 #define ELF_OFFSET 										24
 #define USER_VIDMAP						0xF8000
+#define USER_VIDMAP_BUFFERED			0xF9000
+
+/* pcb vidmap flags */
+#define VIDMAP_DIRECT		0x1		/* USER_VIDMAP maps the terminal's video page */
+#define VIDMAP_BUFFERED		0x2		/* USER_VIDMAP_BUFFERED maps a back buffer */
+
+#define SENDFILE_CHUNK	512	/* sendfile's buffer for sources outside the file system image */
+
+/* lseek whence values */
+#define SEEK_SET	0
+#define SEEK_CUR	1
+#define SEEK_END	2
+#define POS_MAX		0x7FFFFFFF	/* furthest lseek can go */
 
 #define ESP_MASK        0xFFFFE000
 #define PCB_SIZE				0x2000 /* 8 kB pages */
@@ -35,8 +50,14 @@ typedef struct {
 	int32_t (*write) (int32_t fd, const void* buf, int32_t nbytes);
 	int32_t (*open) (const uint8_t* filename);
 	int32_t (*close) (int32_t fd);
+	/* Random access; NULL where the descriptor can't seek */
+	int32_t (*lseek) (int32_t fd, int32_t offset, int32_t whence);
+	int32_t (*pread) (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
 } fops_t;
 
+/* stdin and stdout of processes without a parent */
+extern fops_t terminal_funcs;
+
 /* Device struct */
 typedef struct {
 	uint8_t* name;
@@ -55,13 +76,25 @@ typedef struct {
 /* Process control block struct */
 typedef struct pcb {
 	fd_t file_array[FILE_ARRAY_LEN];
- 	uint8_t arg_buffer[MAX_BUFF_LENGTH];
+ 	uint8_t arg_buffer[MAX_BUFF_LENGTH];	/* whole command line          */
+	uint32_t arg_length;	/* its length                                  */
+	int32_t argc;		/* number of words in it, the first the program */
+	arg_t argv[MAX_ARGS];	/* where each word is in arg_buffer            */
 	int32_t p_id;
 	int32_t par_p_id;
   	uint32_t esp;
   	uint32_t ebp;
+	uint32_t vidmap;	/* VIDMAP_* flags of the video memory it has mapped */
+	uint32_t fpu_used;	/* fpu_state holds its FPU/SSE registers */
+	uint8_t fpu_state[FXSAVE_SIZE] __attribute__((aligned(FXSAVE_ALIGN)));
+	uint32_t detached;	/* runs alongside its parent, which does not wait for it */
+	uint32_t start_eip;	/* until its first time slice: where to enter user mode, */
+	uint32_t start_esp;	/* and with which stack                                */
 } pcb_t;
 
+/* Resets a new process' PCB, stdin and stdout from its parent's */
+void init_pcb(pcb_t* pcb, int32_t p_id, int32_t par_p_id);
+
 /* Used for read/write/open/close */
 pcb_t* get_current_PCB();
 
@@ -78,8 +111,32 @@ int32_t close (int32_t fd);
 /* Checkpoint 4 syscalls */
 int32_t getargs (uint8_t* buf, uint32_t nbytes);
 int32_t vidmap (uint8_t** screen_start);
+/* Maps an off-screen text buffer into user space */
+int32_t vidmap_buffered (uint8_t** screen_start);
+/* Copies the changed cells of the back buffer to the terminal's video page */
+int32_t present (void);
+/* Installs the user video mappings of a process, or unmaps them */
+void remap_vidmap(int32_t p_id);
 int32_t set_handler (int32_t signum, void* handler_address);
 int32_t sigreturn (void);
+/* Makes a pipe; fds[0] reads what fds[1] writes */
+int32_t pipe (int32_t* fds);
+/* Makes newfd a copy of oldfd, closing what newfd had open */
+int32_t dup2 (int32_t oldfd, int32_t newfd);
+/* Streams one descriptor to another without a user buffer */
+int32_t sendfile (int32_t out_fd, int32_t in_fd, int32_t nbytes);
+/* Reads a batch of directory records from an open directory */
+int32_t getdents (int32_t fd, void* buf, int32_t nbytes);
+/* Type, size and inode of a file, by name or by open descriptor */
+int32_t stat (const uint8_t* filename, stat_t* buf);
+int32_t fstat (int32_t fd, stat_t* buf);
+/* Moves a descriptor's position; SEEK_SET, SEEK_CUR or SEEK_END */
+int32_t lseek (int32_t fd, int32_t offset, int32_t whence);
+/* Reads at an offset without moving the position */
+int32_t pread (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+
+/* Leaves the kernel for a process' first instruction */
+void enter_user(uint32_t eip, uint32_t esp);
 
 /* Loads an executable file into correct location in memory */
 int32_t load(dentry_t* d, uint8_t* mem);
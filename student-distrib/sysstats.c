@@ -0,0 +1,181 @@
+/* sysstats.c - Per system call latency accounting
+ * vim:ts=4 noexpandtab
+ */
+
+#include "sysstats.h"
+#include "lib.h"
+#include "sched.h"
+#include "syscalls.h"
+
+#define LINE_LEN            512
+#define NUM_LEN             16
+#define DEC                 10
+#define STAT_ENTRIES        (MAX_DEVICES * (NUM_SYSCALLS + 1))
+
+typedef struct {
+    uint32_t calls;
+    uint32_t errors;                    /* calls that returned < 0 */
+    uint64_t cycles;                    /* total time spent        */
+    uint32_t hist[SYSSTAT_BUCKETS];     /* log2 of cycles per call */
+} sysstat_t;
+
+static sysstat_t sysstats[MAX_DEVICES][NUM_SYSCALLS + 1];
+
+static const int8_t* syscall_names[NUM_SYSCALLS + 1] = {
+    "invalid", "halt", "execute", "read", "write", "open", "close",
+    "getargs", "vidmap", "set_handler", "sigreturn", "vidmap_buffered",
+    "present", "pipe", "dup2", "sendfile", "getdents",
+    "stat", "fstat", "lseek", "pread"
+};
+
+/* log2_bucket
+ *
+ * DESCRIPTION: Index of the highest set bit, capped to the last bucket
+ */
+static uint32_t log2_bucket(uint64_t cycles) {
+    uint32_t hi = (uint32_t)(cycles >> 32), lo = (uint32_t)cycles, bit;
+
+    if (hi != 0) return SYSSTAT_BUCKETS - 1;
+    if (lo == 0) return 0;
+    asm ("bsrl %1, %0" : "=r" (bit) : "rm" (lo));
+    return bit;
+}
+
+/* syscall_account
+ *
+ * DESCRIPTION: Charges one call to the current process. A call that does not
+ *              return to its own frame, like halt, is never charged; execute
+ *              is charged with the whole lifetime of the child
+ * INPUTS: nr - system call number, ret - its return value,
+ *         start - time-stamp counter when sys_call was entered
+ * OUTPUTS: None
+ */
+void syscall_account(uint32_t nr, int32_t ret, uint64_t start) {
+    uint64_t cycles = rdtsc() - start;
+    int32_t pid = get_current_PCB()->p_id;
+    sysstat_t* stat;
+
+    if (pid < 0 || pid >= MAX_DEVICES) return;
+    if (nr > NUM_SYSCALLS) nr = 0;
+
+    stat = &sysstats[pid][nr];
+    stat->calls++;
+    if (ret < 0) stat->errors++;
+    stat->cycles += cycles;
+    stat->hist[log2_bucket(cycles)]++;
+}
+
+/* append
+ *
+ * DESCRIPTION: strcat for the line being built, if s fits in size bytes
+ *              including the terminator
+ * OUTPUTS: 0, or -1 with the line unchanged if s does not fit
+ */
+static int32_t append(int8_t* line, uint32_t size, const int8_t* s) {
+    uint32_t len = strlen(line);
+
+    if (len + strlen(s) >= size) return -1;
+    strcpy(line + len, s);
+    return 0;
+}
+
+/* sysstats_line
+ *
+ * DESCRIPTION: Formats entry index, e.g.
+ *   pid 1 read: 12 calls, 0 errors, avg 5400 cycles, log2 hist 12:10 13:2
+ *              Buckets that don't fit in the line are left out
+ * OUTPUTS: length of the line, 0 for a call that was never made
+ */
+static int32_t sysstats_line(uint32_t index, int8_t* line) {
+    uint32_t pid = index / (NUM_SYSCALLS + 1), nr = index % (NUM_SYSCALLS + 1), b;
+    sysstat_t* stat = &sysstats[pid][nr];
+    int8_t num[NUM_LEN], bucket[2 * NUM_LEN + 2];
+    /* Room for everything but the newline */
+    uint32_t size = LINE_LEN - 1;
+
+    line[0] = '\0';
+    if (stat->calls == 0) return 0;
+
+    append(line, size, "pid ");
+    append(line, size, itoa(pid, num, DEC));
+    append(line, size, " ");
+    append(line, size, syscall_names[nr]);
+    append(line, size, ": ");
+    append(line, size, itoa(stat->calls, num, DEC));
+    append(line, size, " calls, ");
+    append(line, size, itoa(stat->errors, num, DEC));
+    append(line, size, " errors, avg ");
+    append(line, size, itoa((uint32_t)udiv64(stat->cycles, stat->calls), num, DEC));
+    append(line, size, " cycles, log2 hist");
+    for (b = 0; b < SYSSTAT_BUCKETS; b++) {
+        if (stat->hist[b] == 0) continue;
+        strcpy(bucket, " ");
+        append(bucket, sizeof(bucket), itoa(b, num, DEC));
+        append(bucket, sizeof(bucket), ":");
+        append(bucket, sizeof(bucket), itoa(stat->hist[b], num, DEC));
+        if (append(line, size, bucket) != 0) break;
+    }
+    append(line, LINE_LEN, "\n");
+    return strlen(line);
+}
+
+/* sysstats_read
+ *
+ * DESCRIPTION: Returns as many whole lines as fit, continuing from the file
+ *              position on the next call. A line longer than the whole
+ *              buffer is cut short rather than stalling the reader
+ * OUTPUTS: bytes copied, 0 once every line has been read
+ */
+int32_t sysstats_read(int32_t fd, void* buf, int32_t nbytes) {
+    static int8_t line[LINE_LEN];
+    fd_t* file = &get_current_PCB()->file_array[fd];
+    int32_t len, count = 0;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    while (file->pos < STAT_ENTRIES) {
+        len = sysstats_line(file->pos, line);
+        if (count + len > nbytes) {
+            if (count != 0) break;
+            len = nbytes;
+        }
+        memcpy((uint8_t*)buf + count, line, len);
+        count += len;
+        file->pos++;
+    }
+    return count;
+}
+
+/* sysstats_write
+ *
+ * DESCRIPTION: "reset" clears every counter
+ * OUTPUTS: nbytes on success, -1 for anything else
+ */
+int32_t sysstats_write(int32_t fd, const void* buf, int32_t nbytes) {
+    uint32_t flags;
+
+    if (buf == NULL || nbytes < 5 || strncmp((const int8_t*)buf, "reset", 5)) return -1;
+
+    cli_and_save(flags);
+    memset(sysstats, 0, sizeof(sysstats));
+    restore_flags(flags);
+    return nbytes;
+}
+
+/* sysstats_open
+ *
+ * DESCRIPTION: Nothing to set up
+ * OUTPUT: 0
+ */
+int32_t sysstats_open(const uint8_t* filename) {
+    return 0;
+}
+
+/* sysstats_close
+ *
+ * DESCRIPTION: Nothing to tear down
+ * OUTPUT: 0
+ */
+int32_t sysstats_close(int32_t fd) {
+    return 0;
+}
@@ -0,0 +1,30 @@
+/* sysstats.h - Per system call latency accounting
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _SYSSTATS_H
+#define _SYSSTATS_H
+
+/* Highest system call number; sys_call rejects anything above it */
+#define NUM_SYSCALLS        20
+
+/* Latency buckets: bucket b counts calls that took [2^b, 2^(b+1)) cycles */
+#define SYSSTAT_BUCKETS     32
+
+#ifndef ASM
+
+#include "types.h"
+
+/* Called by sys_call on the way out. Numbers outside 1..NUM_SYSCALLS are
+ * counted under 0 as invalid calls */
+void syscall_account(uint32_t nr, int32_t ret, uint64_t start);
+
+/* The "sysstats" device. Reading returns one line per (pid, call) that has
+ * been made; writing "reset" clears the counters */
+int32_t sysstats_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t sysstats_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t sysstats_open(const uint8_t* filename);
+int32_t sysstats_close(int32_t fd);
+
+#endif /* ASM */
+
+#endif /* _SYSSTATS_H */
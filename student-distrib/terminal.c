@@ -6,6 +6,8 @@
 #include "x86_desc.h"
 #include "paging.h"
 #include "syscalls.h"
+#include "softirq.h"
+#include "serial.h"
 
 #include "utils/char_util.h"
 
@@ -13,7 +15,6 @@
 #define KEYBOARD_PORT 0x60
 
 #define INPUT_CUTOFF  0x3E
-#define TERM_MEM      0xD0000
 
 const unsigned char KEY_TABLE[KEY_SIZE] = {
     '1', '2', '3', '4', '5', '6', '7', '8', '9','0','-', '=',' ', ' ',
@@ -29,6 +30,15 @@ const unsigned char KEY_TABLE[KEY_SIZE] = {
 int last_screen_x[MAX_TERMINAL_NUM];
 int last_screen_y[MAX_TERMINAL_NUM];
 
+/* Scancodes queued by keyboard_handler for keyboard_process. The IRQ is the
+ * only writer of kbd_head and keyboard_process the only writer of kbd_tail,
+ * so neither side has to mask interrupts */
+static volatile uint8_t kbd_ring[KBD_RING_SIZE];
+static volatile uint32_t kbd_head;
+static volatile uint32_t kbd_tail;
+
+static void handle_scancode(uint8_t scancode);
+
 /* terminal_init
  *
  * Initialize terminal vars
@@ -44,6 +54,7 @@ void terminal_init(void) {
   clear_buffer(); // Sets keyboard_buffer and key_index
 
   /* Turn on Keyboard IRQ */
+  open_softirq(SOFTIRQ_KEYBOARD, KEYBOARD_IRQ, keyboard_process);
   enable_irq(1);
 
   /* Intiialize variables */
@@ -56,11 +67,14 @@ void terminal_init(void) {
   table_index = 0;
   current_line = 0;
   wrapped = 0;
-  clear_offset[0] = 0; // Used as the key_buffer offset when clearing the screen
-  clear_offset[1] = 0;
-  clear_offset[2] = 0;
+  for(y = 0; y < MAX_TERMINAL_NUM; y++)
+  {
+    clear_offset[y] = 0; // Used as the key_buffer offset when clearing the screen
+  }
   shell_check = 0;
   alt_check = 0;
+  kbd_head = 0;
+  kbd_tail = 0;
 
   for(y = 0; y < MAX_TERMINAL_NUM; y++)
   {
@@ -104,15 +118,37 @@ void remove_term_process(int32_t pid)
 }
 
 /* get_term_vid_addr
- * Gets the starting address for that terminal's video cache
+ * Gets the starting address of that terminal's page of VGA text memory.
+ * Each terminal owns one 4 KB page of the 32 KB text window, so output to
+ * a hidden terminal lands in real video memory and is shown by page-flipping
  */
 uint32_t get_term_vid_addr(uint32_t term)
 {
-    if (term > 2 || term < 0) {
+    if (term >= MAX_TERMINAL_NUM) {
         printf("Failure!");
         return -1;
     }
-    return TERM_MEM + (PAGE_SIZE_KB * term); /* PAGE_SIZE_KB comes from x86_Desc.h */
+    return VIDEO + (PAGE_SIZE_KB * term); /* PAGE_SIZE_KB comes from x86_Desc.h */
+}
+
+/* save_term_pos
+ * Remembers the text position of a terminal that stops running
+ */
+void save_term_pos(uint32_t term)
+{
+    if (term >= MAX_TERMINAL_NUM) return;
+    last_screen_x[term] = get_screen_x();
+    last_screen_y[term] = get_screen_y();
+}
+
+/* restore_term_pos
+ * Brings back the text position of a terminal that starts running
+ */
+void restore_term_pos(uint32_t term)
+{
+    if (term >= MAX_TERMINAL_NUM) return;
+    set_screen_x(last_screen_x[term]);
+    set_screen_y(last_screen_y[term]);
 }
 
 /* terminal_open
@@ -127,7 +163,8 @@ int32_t terminal_open(const uint8_t* filename) {
 
 /* terminal_close
  *
- * Initialize terminal variables
+ * Closes a copy of the terminal made by dup2. The keyboard stays on, as
+ * stdin and the other copies still use it
  * Input - fd 0 filediscriptor
  * Output - None
  */
@@ -139,9 +176,6 @@ int32_t terminal_close(int32_t fd)
     return -1; /* Return fail if I/O fd */
   }
 
-  /* Disable terminal */
-  disable_irq(1);
-
   return 0; /* Success */
 }
 
@@ -164,6 +198,19 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
   /* Initialize temp buffer */
   int8_t buffer[MAX_BUFF_LENGTH];
 
+  /* Fail if no bytes, or negative bytes to be returned, without waiting */
+  /* for a line; a pipe reads 0 bytes instead, so programs can tell them */
+  if(nbytes <= 0)
+  {
+    return -1;
+  }
+
+  /* The serial terminal takes its lines from the UART, not the keyboard */
+  if(running_terminal == SERIAL_TERMINAL)
+  {
+    return serial_getline((uint8_t*)buf, nbytes);
+  }
+
   update_cursor(get_screen_x(), get_screen_y());
 
   for(x = 0; x < MAX_BUFF_LENGTH; x++)
@@ -171,19 +218,20 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
     buffer[x] = '\0';
   }
 
-  /* Loop until enter is pressed */
+  /* Loop until enter is pressed, handling keys as they arrive */
 
   enter_down = 0;
   sti();
-  while(!enter_down);
-  // cli();
-  enter_down = 0;
-
-  /* Fail if no bytes, or negative bytes to be returned */
-  if(nbytes <= 0)
+  while(!enter_down)
   {
-    return -1;
+    /* Keys queued behind an earlier line are not marked pending */
+    keyboard_process();
+    do_softirq();
+    /* Pipeline stages on this terminal run meanwhile */
+    sched_yield();
   }
+  // cli();
+  enter_down = 0;
 
   /* Prep byte counter */
   count = 0;
@@ -241,50 +289,20 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
  */
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes)
 {
-  int32_t x, count;
-
-
-  /* Initialize temp buffer */
-  int8_t buffer[nbytes];
-
-  count = 0;
-  for(x = 0; x < nbytes; x++)
-  {
-    buffer[x] = '\0';
-  }
-
   /* Return failure if buf is empty, or no/negative bytes to be written */
   if(buf == NULL || nbytes <= 0)
   {
     return -1;
   }
 
-  /* Store temp buffer in buf */
-  copy_buf((uint8_t*)buf, (uint8_t*)buffer, nbytes);
-
-  /* Write data to the screen */
-  for(x = 0; x < nbytes; x++)
+  /* The serial terminal has no screen */
+  if(running_terminal == SERIAL_TERMINAL)
   {
-    if((x % 80 == 0) && x != 0 && (get_screen_y() + 1 == NUM_ROWS))
-    {
-        set_screen_y(get_screen_y() + 1);
-        scroll_handle();
-    } else if ((x % 80 == 0) && (x != 0)) {
-        wrap_around();
-    }
-
-    if(buffer[x] != '\0')
-    {
-      putc(buffer[x]);
-      count++;
-    }
+    return serial_write(fd, buf, nbytes);
   }
 
-  // /* Close critical section */
-  // sti();
-
-  /* Return number of bytes written */
-  return count;
+  /* Render straight from the caller's buffer, returning characters written */
+  return write_text((const uint8_t*)buf, nbytes);
 }
 
 /* clear_buffer
@@ -345,47 +363,98 @@ uint32_t get_display_terminal(void)
  *  INPUT: term - the terminal number to switch to
  *  OUTPUT: None
  *  RETURNS: returns 0 on success
- *  SIDE EFFECTS: maps the selected termnial to the correct video memory location and saves previous terminal data and pos
+ *  SIDE EFFECTS: points the VGA CRTC at the selected terminal's video page
+ *                and moves the cursor there. No video memory is copied
  */
 uint32_t switch_display_terminal(uint32_t term) {
+    int x, y;
+
+    if (term == running_terminal) {
+        x = get_screen_x();
+        y = get_screen_y();
+    } else {
+        x = last_screen_x[term];
+        y = last_screen_y[term];
+    }
 
-    uint32_t cur_term = display_terminal;
-
-    /* Save state */
-    last_screen_x[cur_term] = get_screen_x();
-    last_screen_y[cur_term] = get_screen_y();
-
-    /* Copy video memory into current process' cold storage */
-    memcpy((void *) get_term_vid_addr(cur_term), (void*) VIDEO,  PAGE_SIZE_KB);
-
-    /* Copy new video memory into physical video memory */
-    memcpy((void *) VIDEO, (void*) get_term_vid_addr(term),  PAGE_SIZE_KB);
-
-    /* Restore State */
     display_terminal = term;
-    set_screen_x(last_screen_x[term]);
-    set_screen_y(last_screen_y[term]);
-    update_cursor(last_screen_x[term], last_screen_y[term]);
+    show_video_page((char*) get_term_vid_addr(term), x, y);
     return 0;
 }
 
 
 /*
 * keyboard_handler(void)
-* DESCRIPTION: Works with the assemlby linkage to fill keyboard buffer
+* DESCRIPTION: Top half of the keyboard IRQ. Only queues the scancode in
+*              kbd_ring; keyboard_process does the rest as deferred work
 * INPUTS: None
 * OUTPUT: None
 */
 int32_t keyboard_handler(void)
 {
-  /* Initialize variables */
-  uint8_t scancode, input, temp_x, temp_y, temp;
+  uint8_t scancode;
+  uint32_t head;
 
   /* Get keystroke from keyboard */
   scancode = inb(KEYBOARD_PORT);
 
-  /* Switch to the task in this program */
-  switch_running_terminal(display_terminal);
+  /* Drop the key if the consumer is a full ring behind */
+  head = kbd_head;
+  if(head - kbd_tail < KBD_RING_SIZE)
+  {
+    kbd_ring[head & KBD_RING_MASK] = scancode;
+    kbd_head = head + 1;
+  }
+  raise_softirq(SOFTIRQ_KEYBOARD);
+
+  /* Send interrupt signal for keyboard, the first IRQ */
+  send_eoi(KEYBOARD_IRQ);
+  return 0;
+}
+
+/*
+* keyboard_process(void)
+* DESCRIPTION: Bottom half of the keyboard IRQ. Drains kbd_ring, translating,
+*              echoing and line-editing each scancode. Only the displayed
+*              terminal consumes keys, since echo goes through video_mem;
+*              otherwise the work is left pending for a later pass
+* INPUTS: None
+* OUTPUT: None
+*/
+void keyboard_process(void)
+{
+  uint32_t tail;
+
+  if(running_terminal != display_terminal)
+  {
+    raise_softirq(SOFTIRQ_KEYBOARD);
+    return;
+  }
+
+  while((tail = kbd_tail) != kbd_head)
+  {
+    uint8_t scancode = kbd_ring[tail & KBD_RING_MASK];
+    kbd_tail = tail + 1;
+    handle_scancode(scancode);
+
+    /* Hand a finished line to the reader before its key release clears it */
+    if(enter_down)
+    {
+      break;
+    }
+  }
+}
+
+/*
+* handle_scancode(uint8_t scancode)
+* DESCRIPTION: Applies one scancode to the displayed terminal
+* INPUTS: scancode - raw byte read from the keyboard port
+* OUTPUT: None
+*/
+static void handle_scancode(uint8_t scancode)
+{
+  /* Initialize variables */
+  uint8_t input, temp_x, temp_y, temp;
 
   /* Handle keystroke */
   switch(scancode)
@@ -394,31 +463,31 @@ int32_t keyboard_handler(void)
     {
       /* if on turn off, and vice versa */
       capslock_check = !capslock_check;
-      goto SEND_EOI;
+      return;
     }
     case L_SHIFT:
     {
       /* set keyboard offset to access SHIFTed keys */
       L_shift_check = 1;
-      goto SEND_EOI;
+      return;
     }
     case L_SHIFT_OFF:
     {
       /* Reset keyboard offset to 0, for unSHIFTed keys */
       L_shift_check = 0;
-      goto SEND_EOI;
+      return;
     }
     case R_SHIFT:
     {
       /* set keyboard offset to access SHIFTed keys */
       R_shift_check = 1;
-      goto SEND_EOI;
+      return;
     }
     case R_SHIFT_OFF:
     {
       /* Reset keyboard offset to 0, for unSHIFTed keys */
       R_shift_check = 0;
-      goto SEND_EOI;
+      return;
     }
     case SPACE:
     {
@@ -432,7 +501,7 @@ int32_t keyboard_handler(void)
       /* Update cursor                                                                */
       update_cursor(get_screen_x(), get_screen_y());
 
-      goto SEND_EOI;
+      return;
     }
     case TAB:
     {
@@ -447,7 +516,7 @@ int32_t keyboard_handler(void)
         /* Update cursor                                                                */
         update_cursor(get_screen_x(), get_screen_y());
       }
-      goto SEND_EOI;
+      return;
     }
     case BACK:
     {
@@ -463,31 +532,47 @@ int32_t keyboard_handler(void)
         key_index[display_terminal]--;
       }
 
-      goto SEND_EOI;
+      return;
+    }
+    case PAGE_UP: /* Shift+PgUp scrolls back through history */
+    {
+      if(L_shift_check || R_shift_check)
+      {
+        scroll_view(NUM_ROWS - 1);
+      }
+      return;
+    }
+    case PAGE_DOWN:
+    {
+      if(L_shift_check || R_shift_check)
+      {
+        scroll_view(-(NUM_ROWS - 1));
+      }
+      return;
     }
     case CTRL:
     {
       /* turn on flag */
       ctrl_check = 1;
-      goto SEND_EOI;
+      return;
     }
     case CTRL_OFF:
     {
       /* turn off flag */
       ctrl_check = 0;
-      goto SEND_EOI;
+      return;
     }
     case ALT:
     {
       /* turn on flag */
       alt_check = 1;
-      goto SEND_EOI;
+      return;
     }
     case ALT_OFF:
     {
       /* turn off flag */
       alt_check = 0;
-      goto SEND_EOI;
+      return;
     }
     case ENTER:
     {
@@ -505,13 +590,13 @@ int32_t keyboard_handler(void)
       /* Should trigger terminal_write */
       enter_down = 1;
 
-      goto SEND_EOI;
+      return;
     }
     case ENTER_OFF:
     {
       enter_down = 0;
 
-      goto SEND_EOI;
+      return;
     }
     case F1: /* Handle switch to 1st terminal */
     {
@@ -522,9 +607,8 @@ int32_t keyboard_handler(void)
             if (switch_running_terminal(0)) {
                 execute(dechar("shell"));
             }
-            send_eoi(1);
         }
-        goto SEND_EOI;
+        return;
     }
     case F2:
     {
@@ -532,12 +616,10 @@ int32_t keyboard_handler(void)
         {
             switch_display_terminal(1);
             if (switch_running_terminal(1)) {
-                send_eoi(1);
                 execute(dechar("shell"));
             }
-            send_eoi(1);
         }
-        goto SEND_EOI;
+        return;
     }
     case F3:
     {
@@ -545,12 +627,10 @@ int32_t keyboard_handler(void)
         {
             switch_display_terminal(2);
             if (switch_running_terminal(2)) {
-                send_eoi(1);
                 execute(dechar("shell"));
             }
-            send_eoi(1);
         }
-        goto SEND_EOI;
+        return;
     }
     default:
     {
@@ -610,9 +690,7 @@ int32_t keyboard_handler(void)
 
           current_line = 0;
 
-          /* End interrupt */
-          send_eoi(1);
-          return 0;
+          return;
         }
 
         /* Get current screen_x and screen_y */
@@ -669,9 +747,4 @@ int32_t keyboard_handler(void)
       }
     }
   }
-
-  SEND_EOI:
-      /* Send interrupt signal for keyboard, the first IRQ */
-      send_eoi(1);
-      return 0;
 }
@@ -4,6 +4,8 @@
 #define _TERMINAL_H
 
 #define MAX_BUFF_LENGTH 128
+#define KBD_RING_SIZE 64 /* must be a power of two */
+#define KBD_RING_MASK (KBD_RING_SIZE - 1)
 
 #define SHIFT_OFFSET 52
 #define TABLE_OFFSET 2
@@ -30,6 +32,8 @@
 #define F1 0x3B
 #define F2 0x3C
 #define F3 0x3D
+#define PAGE_UP 0x49
+#define PAGE_DOWN 0x51
 
 
 #include "types.h"
@@ -62,6 +66,8 @@ void terminal_init(void);
 void set_term_process(int32_t pid);
 void remove_term_process(int32_t pid);
 uint32_t get_term_vid_addr(uint32_t term);
+void save_term_pos(uint32_t term);
+void restore_term_pos(uint32_t term);
 int32_t terminal_open(const uint8_t* filename);
 int32_t terminal_close(int32_t fd);
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes);
@@ -70,5 +76,6 @@ int32_t clear_buffer();
 uint32_t get_key_index(void);
 uint32_t get_display_terminal(void);
 int32_t keyboard_handler(void);
+void keyboard_process(void);
 
 #endif  /* _TERMINAL_H   */
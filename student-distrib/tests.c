@@ -2,10 +2,14 @@
 #include "tests/checkpoint1.h"
 #include "tests/checkpoint2.h"
 #include "tests/checkpoint3.h"
+#include "tests/benchmark.h"
 
 /* Test suite entry point */
 void launch_tests(){
 	//test_all_checkpoint1();
 	//test_all_checkpoint2();
 	test_all_checkpoint3();
+#if RUN_BENCHMARKS
+	run_benchmarks();
+#endif
 }
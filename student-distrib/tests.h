@@ -4,6 +4,16 @@
 #define PASS 1
 #define FAIL 0
 
+/* Run the microbenchmarks in tests/benchmark.c after the tests */
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS 0
+#endif
+
+/* Power QEMU off through its isa-debug-exit device once they are done */
+#ifndef PERF_EXIT
+#define PERF_EXIT 0
+#endif
+
 /* format these macros as you see fit */
 #define TEST_HEADER 	\
 	printf("[TEST %s] Running %s at %s:%d\n", __FUNCTION__, __FUNCTION__, __FILE__, __LINE__)
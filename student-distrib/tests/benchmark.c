@@ -0,0 +1,262 @@
+#include "../tests.h"
+#include "../types.h"
+#include "../lib.h"
+#include "../filesys.h"
+#include "../terminal.h"
+#include "../syscalls.h"
+#include "../paging.h"
+#include "../sched.h"
+#include "../serial.h"
+#include "../pipe.h"
+#include "../pit.h"
+#include "../i8259.h"
+#include "../utils/char_util.h"
+
+/* Only benchmark builds carry the suite and its 64 kB of buffers */
+#if RUN_BENCHMARKS
+
+/* Microbenchmarks
+ *
+ * Every benchmark times a number of iterations with the time-stamp counter
+ * and writes one line per benchmark to the serial port:
+ *
+ *   @bench <name> <iterations> <min> <median> <p99>
+ *
+ * all in cycles, so results can be compared across builds.
+ */
+
+#define BENCH_ITERS     256
+#define BENCH_SLOW_ITERS 16     /* for benchmarks that run a program */
+#define BENCH_BUF_SIZE  32768
+#define LINE_LEN        128
+#define NUM_LEN         16
+#define DEC             10
+#define P99             99
+#define PERCENT         100
+#define SAVED_STDOUT    7       /* where pipe_cat keeps its stdout */
+
+/* QEMU's isa-debug-exit device; writing v exits with status (v << 1) | 1 */
+#define QEMU_EXIT_PORT  0xF4
+
+static uint32_t samples[BENCH_ITERS];
+static uint8_t bench_src[BENCH_BUF_SIZE];
+static uint8_t bench_dst[BENCH_BUF_SIZE];
+
+/* Time body iters times, then report it under name */
+#define BENCH(name, iters, body)                            \
+do {                                                        \
+    uint32_t iter_;                                         \
+    uint64_t start_;                                        \
+    for (iter_ = 0; iter_ < (iters); iter_++) {             \
+        start_ = rdtsc();                                   \
+        body;                                               \
+        samples[iter_] = (uint32_t)(rdtsc() - start_);      \
+    }                                                       \
+    bench_report((name), (iters));                          \
+} while (0)
+
+/* bench_report
+ *
+ * Sorts the samples and writes the benchmark's line to the serial port
+ * Inputs: name, iters - number of samples taken
+ * Outputs: None
+ */
+static void bench_report(const int8_t* name, uint32_t iters) {
+    int8_t line[LINE_LEN], num[NUM_LEN];
+    uint32_t i, j, key;
+
+    /* Insertion sort; there are at most a few hundred samples */
+    for (i = 1; i < iters; i++) {
+        key = samples[i];
+        for (j = i; j > 0 && samples[j - 1] > key; j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = key;
+    }
+
+    /* Start on a fresh line in case console output was mirrored before */
+    strcpy(line, "\n@bench ");
+    strcpy(line + strlen(line), name);
+    strcpy(line + strlen(line), " ");
+    strcpy(line + strlen(line), itoa(iters, num, DEC));
+    strcpy(line + strlen(line), " ");
+    strcpy(line + strlen(line), itoa(samples[0], num, DEC));
+    strcpy(line + strlen(line), " ");
+    strcpy(line + strlen(line), itoa(samples[iters / 2], num, DEC));
+    strcpy(line + strlen(line), " ");
+    strcpy(line + strlen(line), itoa(samples[(iters * P99) / PERCENT], num, DEC));
+    strcpy(line + strlen(line), "\n");
+    serial_write(0, line, strlen(line));
+}
+
+/* File system benchmarks
+ *
+ * Coverage: read_data at several sizes, read_dentry_by_name
+ * Files: filesys.h/c
+ */
+static void bench_filesys() {
+    dentry_t dentry;
+
+    /* fish is the only file larger than the biggest read */
+    if (read_dentry_by_name(dechar("fish"), &dentry) != 0) {
+        printf("bench: fish missing\n");
+        return;
+    }
+
+    BENCH("read_data_64", BENCH_ITERS, read_data(dentry.inode_index, 0, bench_dst, 64));
+    BENCH("read_data_1k", BENCH_ITERS, read_data(dentry.inode_index, 0, bench_dst, 1024));
+    BENCH("read_data_4k", BENCH_ITERS, read_data(dentry.inode_index, 0, bench_dst, 4096));
+    BENCH("read_data_32k", BENCH_ITERS, read_data(dentry.inode_index, 0, bench_dst, BENCH_BUF_SIZE));
+
+    BENCH("read_dentry_first", BENCH_ITERS, read_dentry_by_name(dechar("."), &dentry));
+    BENCH("read_dentry_long", BENCH_ITERS,
+          read_dentry_by_name(dechar("verylargetextwithverylongname.txt"), &dentry));
+    BENCH("read_dentry_missing", BENCH_ITERS, read_dentry_by_name(dechar("nosuchfile"), &dentry));
+}
+
+/* Memory benchmarks
+ *
+ * Coverage: memcpy, memset
+ * Files: lib.h/c
+ */
+static void bench_memory() {
+    BENCH("memcpy_64", BENCH_ITERS, memcpy(bench_dst, bench_src, 64));
+    BENCH("memcpy_4k", BENCH_ITERS, memcpy(bench_dst, bench_src, 4096));
+    BENCH("memcpy_32k", BENCH_ITERS, memcpy(bench_dst, bench_src, BENCH_BUF_SIZE));
+    BENCH("memset_64", BENCH_ITERS, memset(bench_dst, 0, 64));
+    BENCH("memset_4k", BENCH_ITERS, memset(bench_dst, 0, 4096));
+    BENCH("memset_32k", BENCH_ITERS, memset(bench_dst, 0, BENCH_BUF_SIZE));
+}
+
+/* Console benchmarks
+ *
+ * Coverage: putc, terminal_write, scroll_handle
+ * Files: lib.h/c, terminal.h/c
+ */
+static void bench_console() {
+    uint8_t line[NUM_COLS];
+
+    memset(line, 'x', NUM_COLS - 1);
+    line[NUM_COLS - 1] = '\n';
+
+    BENCH("putc", BENCH_ITERS, putc('x'));
+    BENCH("terminal_write_line", BENCH_ITERS, terminal_write(1, line, NUM_COLS));
+    BENCH("scroll_handle", BENCH_ITERS, scroll_handle());
+    clear();
+}
+
+/* Paging benchmarks
+ *
+ * Coverage: map_v_p, flush_tlb
+ * Files: paging.h/c
+ */
+static void bench_paging() {
+    BENCH("map_v_p_4k", BENCH_ITERS, map_v_p(USER_VIDMAP_BUFFERED, VIDEO, 0, 1, 1));
+    map_v_p(USER_VIDMAP_BUFFERED, 0, 0, 1, 1);
+    BENCH("map_v_p_4m", BENCH_ITERS,
+          map_v_p(USER_PROCESS_START_VIRTUAL, USER_PROCESS_START_PHYSICAL, 1, 1, 1));
+    BENCH("flush_tlb", BENCH_ITERS, flush_tlb());
+}
+
+/* pipe_page
+ *
+ * Writes one page into a pipe and reads it back, without a context switch
+ * Inputs: fds - the pipe's read and write ends
+ */
+static void pipe_page(int32_t* fds) {
+    write(fds[1], bench_src, PIPE_SIZE);
+    read(fds[0], bench_dst, PIPE_SIZE);
+}
+
+/* pipe_cat
+ *
+ * Producer/consumer pair: cat writes fish (36 kB) into a pipe while this
+ * process reads it, the two switching whenever the page fills or drains
+ * Inputs: None
+ */
+static void pipe_cat() {
+    int32_t fds[2];
+
+    if (pipe(fds) != 0) return;
+    dup2(1, SAVED_STDOUT);
+    dup2(fds[1], 1);
+    close(fds[1]);
+    execute(dechar("cat fish"));
+    dup2(SAVED_STDOUT, 1);
+    close(SAVED_STDOUT);
+
+    while (read(fds[0], bench_dst, BENCH_BUF_SIZE) > 0);
+    close(fds[0]);
+}
+
+/* Process benchmarks
+ *
+ * Runs as a stand-in process so execute has a parent to return to and the
+ * scheduler has a task to switch to
+ * Coverage: execute/halt, switch_running_terminal, pipe read/write
+ * Files: syscalls.h/c, sched.h/c, pipe.h/c
+ */
+static void bench_stand_in() {
+    int32_t pid = add_process();
+    int32_t fds[2];
+
+    if (pid < 0) {
+        printf("bench: no free process\n");
+        return;
+    }
+    /* Without a parent it gets the terminal, which children inherit */
+    init_pcb(find_PCB(pid), pid, -1);
+
+    BENCH("execute_halt", BENCH_SLOW_ITERS, execute(dechar("testprint")));
+    /* Switching to ourselves takes the full save/map/restore path */
+    BENCH("switch_running_terminal", BENCH_ITERS, switch_running_terminal(running_terminal));
+
+    if (pipe(fds) == 0) {
+        BENCH("pipe_4k", BENCH_ITERS, pipe_page(fds));
+        close(fds[0]);
+        close(fds[1]);
+    }
+    BENCH("pipe_cat_36k", BENCH_SLOW_ITERS, pipe_cat());
+
+    delete_process(pid);
+    clear();
+}
+
+/* With the PIT, sched_init leaves no terminal running until the first
+ * tick, and ticks would move the stand-in's children between terminals.
+ * Hold the timer off and run on terminal 0 meanwhile */
+static void bench_process() {
+    uint32_t saved_terminal = running_terminal;
+
+    if (USING_PIT) {
+        disable_irq(PIT_IRQ);
+        running_terminal = 0;
+    }
+
+    bench_stand_in();
+
+    if (USING_PIT) {
+        running_terminal = saved_terminal;
+        enable_irq(PIT_IRQ);
+    }
+}
+
+/* Benchmark suite entry point */
+void run_benchmarks() {
+    memset(bench_src, 'a', BENCH_BUF_SIZE);
+
+    bench_filesys();
+    bench_memory();
+    bench_console();
+    bench_paging();
+    bench_process();
+    serial_write(0, "\n@bench-done\n", 13);
+
+    if (PERF_EXIT) {
+        /* Let the UART drain before the machine goes away */
+        while (!serial_idle());
+        outb(0, QEMU_EXIT_PORT);
+    }
+}
+
+#endif /* RUN_BENCHMARKS */
@@ -0,0 +1,194 @@
+/* trace.c - Kernel event trace ring
+ * vim:ts=4 noexpandtab
+ */
+
+#include "trace.h"
+#include "lib.h"
+#include "sched.h"
+#include "serial.h"
+#include "softirq.h"
+
+#define NO_PID      0xFFFF
+#define FLUSH_BATCH 256     /* records copied out per TRACE_MAGIC batch */
+
+volatile uint32_t trace_mask = TRACE_DEFAULT_MASK;
+
+static trace_event_t trace_ring[TRACE_RING_SIZE];
+static volatile uint32_t trace_head;   /* next slot to hand out          */
+static uint32_t trace_tail;            /* next slot to drain or read     */
+static uint32_t trace_lost;            /* records overwritten undrained  */
+
+/* trace_flush's copy, so the serial port never reads a slot being reused */
+static trace_event_t flush_buf[FLUSH_BATCH];
+
+/* lap_of
+ *
+ * DESCRIPTION: The completion marker a record in slot index carries once it
+ *              has been written. Never 0, so a zeroed slot reads as empty
+ */
+static inline uint8_t lap_of(uint32_t index) {
+    return (uint8_t)((index >> TRACE_RING_ORDER) + 1);
+}
+
+/* trace_init
+ *
+ * DESCRIPTION: Drains the ring to the serial port from deferred work
+ * INPUT/OUTPUT: None
+ */
+void trace_init(void) {
+    open_softirq(SOFTIRQ_TRACE, SERIAL_IRQ, trace_flush);
+}
+
+/* trace_event
+ *
+ * DESCRIPTION: Claims a slot with one atomic add and fills it in, so it may
+ *              be called from any context, including an interrupt that lands
+ *              in the middle of another trace_event. The oldest records are
+ *              overwritten when the drain falls behind
+ * INPUTS: type - TRACE_* event type
+ *         arg  - event specific value
+ * OUTPUTS: None
+ */
+void trace_event(uint32_t type, uint32_t arg) {
+    trace_event_t* ev;
+    uint32_t index = 1;
+
+    asm volatile ("lock; xaddl %0, %1"
+        : "+r" (index), "+m" (trace_head)
+        :
+        : "memory", "cc"
+    );
+
+    ev = &trace_ring[index & TRACE_RING_MASK];
+    ev->lap = 0;
+    ev->tsc = rdtsc();
+    ev->arg = arg;
+    ev->type = (uint8_t)type;
+    ev->pid = (running_terminal < MAX_TERMINAL_NUM && running_procs[running_terminal] >= 0)
+            ? (uint16_t)running_procs[running_terminal] : NO_PID;
+    asm volatile ("" : : : "memory");
+    ev->lap = lap_of(index);
+
+    /* Start draining once half the ring is waiting */
+    if (index - trace_tail == TRACE_RING_SIZE / 2) {
+        raise_softirq(SOFTIRQ_TRACE);
+    }
+}
+
+/* trace_next
+ *
+ * DESCRIPTION: Moves the tail to the oldest record still in the ring and
+ *              reports whether it has been completely written
+ * OUTPUTS: pointer to the record, NULL if there is nothing to take
+ */
+static trace_event_t* trace_next(void) {
+    uint32_t head = trace_head;
+    trace_event_t* ev;
+
+    if (head - trace_tail > TRACE_RING_SIZE) {
+        trace_lost += head - trace_tail - TRACE_RING_SIZE;
+        trace_tail = head - TRACE_RING_SIZE;
+    }
+    if (trace_tail == head) return NULL;
+
+    ev = &trace_ring[trace_tail & TRACE_RING_MASK];
+    if (ev->lap != lap_of(trace_tail)) return NULL;
+    return ev;
+}
+
+/* trace_copy
+ *
+ * DESCRIPTION: Copies the record at the tail and moves past it. A record
+ *              overwritten during the copy is dropped; trace_next then
+ *              counts it as lost
+ * INPUTS: dest - where to put the record
+ * OUTPUTS: 1 if a record was copied, 0 if there is nothing to take
+ */
+static uint32_t trace_copy(trace_event_t* dest) {
+    trace_event_t* ev;
+
+    while ((ev = trace_next()) != NULL) {
+        *dest = *ev;
+        asm volatile ("" : : : "memory");
+        if (ev->lap == lap_of(trace_tail) && dest->lap == lap_of(trace_tail)) {
+            trace_tail++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* trace_flush
+ *
+ * DESCRIPTION: Writes every completed record to the serial port, in
+ *              TRACE_MAGIC batches of up to FLUSH_BATCH. Records are copied
+ *              out first, so producers may reuse their slots while the slow
+ *              serial writes go on. Stops early at a record still being written
+ * INPUT/OUTPUT: None
+ */
+void trace_flush(void) {
+    uint32_t count, lost, magic = TRACE_MAGIC;
+
+    do {
+        /* Copy first, so the header can go out ahead of the records */
+        for (count = 0; count < FLUSH_BATCH && trace_copy(&flush_buf[count]); count++);
+        if (count == 0) return;
+        lost = trace_lost;
+        trace_lost = 0;
+
+        serial_write(0, &magic, sizeof(magic));
+        serial_write(0, &count, sizeof(count));
+        serial_write(0, &lost, sizeof(lost));
+        serial_write(0, flush_buf, count * sizeof(trace_event_t));
+    } while (count == FLUSH_BATCH);
+}
+
+/* trace_read
+ *
+ * DESCRIPTION: Copies out whole records, oldest first
+ * INPUTS: buf - destination, nbytes - its size
+ * OUTPUTS: number of bytes copied
+ */
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes) {
+    trace_event_t ev;
+    int32_t count = 0;
+
+    if (buf == NULL || nbytes < 0) return -1;
+
+    while (count + (int32_t)sizeof(trace_event_t) <= nbytes && trace_copy(&ev)) {
+        memcpy((uint8_t*)buf + count, &ev, sizeof(trace_event_t));
+        count += sizeof(trace_event_t);
+    }
+    return count;
+}
+
+/* trace_write
+ *
+ * DESCRIPTION: Sets the mask of event types to record
+ * INPUTS: buf - a uint32_t mask of TRACE_BIT()s
+ * OUTPUTS: 4 on success, -1 on a short buffer
+ */
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes) {
+    if (buf == NULL || nbytes < (int32_t)sizeof(uint32_t)) return -1;
+
+    trace_mask = *(const uint32_t*)buf & TRACE_ALL;
+    return sizeof(uint32_t);
+}
+
+/* trace_open
+ *
+ * DESCRIPTION: Nothing to set up
+ * OUTPUT: 0
+ */
+int32_t trace_open(const uint8_t* filename) {
+    return 0;
+}
+
+/* trace_close
+ *
+ * DESCRIPTION: Nothing to tear down
+ * OUTPUT: 0
+ */
+int32_t trace_close(int32_t fd) {
+    return 0;
+}
@@ -0,0 +1,66 @@
+/* trace.h - Kernel event trace ring
+ * vim:ts=4 noexpandtab
+ */
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/* Event types; bit (1 << type) of trace_mask enables each one */
+#define TRACE_SYSCALL_ENTER 0   /* arg: syscall number         */
+#define TRACE_SYSCALL_EXIT  1   /* arg: return value           */
+#define TRACE_IRQ_ENTER     2   /* arg: IRQ line               */
+#define TRACE_IRQ_EXIT      3   /* arg: IRQ line               */
+#define TRACE_SWITCH        4   /* arg: pid switched to        */
+#define TRACE_PAGE_FAULT    5   /* arg: faulting address (CR2) */
+#define TRACE_EXECUTE       6   /* arg: pid of the new process */
+#define TRACE_HALT          7   /* arg: exit status            */
+#define NUM_TRACE_EVENTS    8
+
+#define TRACE_BIT(type)     (1 << (type))
+#define TRACE_ALL           ((1 << NUM_TRACE_EVENTS) - 1)
+
+/* Events recorded at boot; the "trace" device changes the mask */
+#define TRACE_DEFAULT_MASK  0
+
+#define TRACE_RING_ORDER    12
+#define TRACE_RING_SIZE     (1 << TRACE_RING_ORDER)
+#define TRACE_RING_MASK     (TRACE_RING_SIZE - 1)
+
+/* Each batch drained to the serial port starts with this magic, then a
+ * 32-bit record count, a 32-bit count of records lost since the previous
+ * batch and that many trace_event_t records, all little endian */
+#define TRACE_MAGIC         0x31435254  /* "TRC1" */
+
+#ifndef ASM
+
+#include "types.h"
+
+typedef struct {
+    uint64_t tsc;   /* time-stamp counter when the event happened */
+    uint32_t arg;   /* event specific, see above                  */
+    uint16_t pid;   /* process running at the time, 0xFFFF if none */
+    uint8_t type;
+    uint8_t lap;    /* written last; marks the record as complete */
+} trace_event_t;
+
+extern volatile uint32_t trace_mask;
+
+/* Record an event; only call through TRACE so a disabled type is one branch */
+void trace_event(uint32_t type, uint32_t arg);
+/* Write everything recorded so far to the serial port */
+void trace_flush(void);
+void trace_init(void);
+
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t trace_open(const uint8_t* filename);
+int32_t trace_close(int32_t fd);
+
+#define TRACE(type, arg)                                \
+do {                                                    \
+    if (trace_mask & TRACE_BIT(type))                   \
+        trace_event((type), (uint32_t)(arg));           \
+} while (0)
+
+#endif /* ASM */
+
+#endif /* _TRACE_H */
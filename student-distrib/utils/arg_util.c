@@ -2,6 +2,39 @@
 #include "char_util.h"
 #include "../lib.h"
 
+/* parse_arguments
+ * DESCRIPTION: Finds every space separated word of an argument string in
+ *                a single pass, so callers needn't rescan the string for
+ *                each argument the way the functions below do
+ * INPUTS: argument_string -- A string of characters with arguments
+ *         argv            -- Where to store each word's offset and length
+ *         max_args        -- Number of entries argv has room for
+ * OUTPUTS: argv filled with the words in order
+ * RETURNS: The number of words, -1 if fail or there are too many
+ * SIDE EFFECTS: None
+ */
+int32_t parse_arguments(const uint8_t* argument_string, arg_t* argv, uint32_t max_args)
+{
+    if ((argument_string == NULL) || (argv == NULL)) return -1;
+
+    uint32_t i, start;
+    uint32_t argc = 0;
+    for (i = 0; argument_string[i] != '\0';) {
+        if (' ' == (char)argument_string[i]) {
+            i++;
+            continue;
+        }
+        if (argc == max_args) return -1;
+
+        start = i;
+        while ((argument_string[i] != '\0') && (' ' != (char)argument_string[i])) i++;
+        argv[argc].offset = start;
+        argv[argc].length = i - start;
+        argc++;
+    }
+    return argc;
+}
+
 /* get_argument_count
  * DESCRIPTION: Get the number of arguments in this argument string,
  *                separated by spaces
@@ -5,6 +5,18 @@
 
 #include "../types.h"
 
+/* A 128 byte command line has at most 64 space separated words */
+#define MAX_ARGS 64
+
+/* One word of an argument string */
+typedef struct {
+    uint16_t offset;    /* index of its first character */
+    uint16_t length;    /* number of characters         */
+} arg_t;
+
+/* Split an argument string into words in one pass */
+int32_t parse_arguments(const uint8_t* argument_string, arg_t* argv, uint32_t max_args);
+
 /* Get number of arguments in string */
 int32_t get_argument_count(const uint8_t* argument_string);
 /* Get argument size */
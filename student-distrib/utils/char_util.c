@@ -2,7 +2,8 @@
 #include "../lib.h"
 
 /* string_length
- * DESCRIPTION: Give the length of an input string, not including EOS
+ * DESCRIPTION: Give the length of an input string, not including EOS.
+ *              Scans a word at a time once s is aligned (see strlen)
  * INPUT: s -- string input
  * OUTPUT: none
  * RETURNS: length of string, or -1 if fail
@@ -12,16 +13,22 @@ int32_t string_length(const uint8_t* s)
 {
     if (s == NULL) return -1;
 
-    int32_t count = 0;
-    while (s[count] != '\0') {
-        count++;
-        if (count > 1000000) return -1;
+    const uint8_t* p = s;
+    const uint32_t* w;
+
+    for (; !WORD_ALIGNED(p); p++) {
+        if (*p == '\0') return p - s;
+    }
+    for (w = (const uint32_t*)p; !HAS_ZERO_BYTE(*w); w++) {
+        if ((const uint8_t*)w - s > STRING_MAX_LEN) return -1;
     }
-    return count;
+    for (p = (const uint8_t*)w; *p != '\0'; p++);
+    return p - s;
 }
 
 /* string_equal
- * DESCRIPTION: Check if two strings are equal
+ * DESCRIPTION: Check if two strings are equal. When both are aligned
+ *              alike, equal words without a terminator are skipped whole
  * INPUT: s1 -- first string input
  *        s2 -- second string input
  * OUTPUT: none
@@ -32,6 +39,19 @@ int32_t string_equal(const uint8_t* s1, const uint8_t* s2)
 {
     if ((s1 == NULL) || (s2 == NULL)) return -1;
 
+    if (((uint32_t)s1 & WORD_MASK) == ((uint32_t)s2 & WORD_MASK)) {
+        for (; !WORD_ALIGNED(s1); s1++, s2++) {
+            if (*s1 != *s2) return 0;
+            if (*s1 == '\0') return 1;
+        }
+        for (;; s1 += sizeof(uint32_t), s2 += sizeof(uint32_t)) {
+            uint32_t w = *(const uint32_t*)s1;
+            if (w != *(const uint32_t*)s2) break;
+            /* Equal up to and including a terminator */
+            if (HAS_ZERO_BYTE(w)) return 1;
+        }
+    }
+
     int32_t i;
     for (i = 0; (s1[i] != '\0') && (s2[i] != '\0'); i++) {
         if (s1[i] != s2[i]) return 0;
@@ -58,16 +78,14 @@ int32_t substring(const uint8_t* s, uint8_t* buf, uint32_t start, uint32_t end)
     int32_t len = string_length(s);
     if ((start < 0) || (end < start) || (end > len)) return -1;
 
-    int32_t i;
-    for (i = start; i < end; i++) {
-        buf[i - start] = s[i];
-    }
+    memcpy(buf, s + start, end - start);
     buf[end - start] = '\0';
     return 0;
 }
 
 /* copy_string
- * DESCRIPTION: Copies a string into another
+ * DESCRIPTION: Copies a string into another, a word at a time while
+ *              source and destination are aligned alike
  * INPUT: source -- original string, which doesn't change
  *        dest   -- the destination string location
  * OUTPUT: none
@@ -77,13 +95,19 @@ int32_t substring(const uint8_t* s, uint8_t* buf, uint32_t start, uint32_t end)
 int32_t copy_string(const uint8_t* source, uint8_t* dest)
 {
     if ((source == NULL) || (dest == NULL)) return -1;
-    int32_t len = string_length(source);
 
-    int32_t i;
-    for (i = 0; i < len; i++) {
-        dest[i] = source[i];
+    if (((uint32_t)source & WORD_MASK) == ((uint32_t)dest & WORD_MASK)) {
+        for (; !WORD_ALIGNED(source); source++, dest++) {
+            if ((*dest = *source) == '\0') return 0;
+        }
+        for (;; source += sizeof(uint32_t), dest += sizeof(uint32_t)) {
+            uint32_t w = *(const uint32_t*)source;
+            if (HAS_ZERO_BYTE(w)) break;
+            *(uint32_t*)dest = w;
+        }
     }
-    dest[len] = '\0';
+
+    while ((*dest++ = *source++) != '\0');
     return 0;
 }
 
@@ -4,6 +4,9 @@
 
 #include "../types.h"
 
+/* Longest string string_length will scan before giving up */
+#define STRING_MAX_LEN  1000000
+
 int32_t string_length(const uint8_t* s);
 /* Calculate whether two strings are equal */
 int32_t string_equal(const uint8_t* s1, const uint8_t* s2);
@@ -8,7 +8,9 @@
 
 #include "types.h"
 
+#ifndef USING_PIT
 #define USING_PIT 0
+#endif
 
 /* Segment selector values */
 #define KERNEL_CS   0x0010
@@ -3,28 +3,30 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
+#define SEND_ALL 0x7FFFFFFF
+
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd;
     uint8_t buf[1024];
 
+    /* Without a file, copy stdin if it is a pipe; a zero-byte read */
+    /* succeeds on a pipe but not on the keyboard                    */
     if (0 != ece391_getargs (buf, 1024)) {
-        ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
-	return 3;
-    }
-
-    if (-1 == (fd = ece391_open (buf))) {
+	if (0 != ece391_read (0, buf, 0)) {
+	    ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
+	    return 3;
+	}
+	fd = 0;
+    } else if (-1 == (fd = ece391_open (buf))) {
         ece391_fdputs (1, (uint8_t*)"file not found\n");
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, 1024))) {
-        if (-1 == cnt) {
-	    ece391_fdputs (1, (uint8_t*)"file read failed\n");
-	    return 3;
-	}
-	if (-1 == ece391_write (1, buf, cnt))
-	    return 3;
+    /* The kernel streams the whole file to stdout, until end of file */
+    if (-1 == ece391_sendfile (1, fd, SEND_ALL)) {
+	ece391_fdputs (1, (uint8_t*)"file read failed\n");
+	return 3;
     }
 
     return 0;
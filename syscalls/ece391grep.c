@@ -6,17 +6,14 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/* Prints the lines of fd containing s, after "fname:" unless fname is 0 */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_one_fd (const char* s, int32_t fd, const char* fname) 
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
+    int32_t cnt, last, line_start, line_end, check, s_len;
     uint8_t data[BUFSIZE+1];
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
-    }
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -42,8 +39,10 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
+		    if (0 != fname) {
+			ece391_fdputs (1, (uint8_t*)fname);
+			ece391_fdputs (1, (uint8_t*)":");
+		    }
 		    ece391_fdputs (1, data + line_start);
 		    ece391_fdputs (1, (uint8_t*)"\n");
 		    break;
@@ -58,6 +57,20 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (0 != do_one_fd (s, fd, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -76,6 +89,11 @@ int main ()
         return 3;
     }
 
+    /* Filter stdin if it is a pipe; a zero-byte read succeeds on a pipe */
+    /* but not on the keyboard. Otherwise search every file              */
+    if (0 == ece391_read (0, buf, 0))
+        return (0 == do_one_fd ((char*)search, 0, 0)) ? 0 : 3;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
@@ -3,25 +3,33 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define NAME_LEN 32
+#define BATCH 32
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i, j, len;
+    dirent_t ents[BATCH];
+    uint8_t buf[BATCH * (NAME_LEN + 1)];
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    /* One getdents and one write per batch of names */
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
+	    len = 0;
+	    for (i = 0; i < cnt / (int32_t)sizeof (dirent_t); i++) {
+	        for (j = 0; j < NAME_LEN && '\0' != ents[i].name[j]; j++)
+	            buf[len++] = ents[i].name[j];
+	        buf[len++] = '\n';
+	    }
+	    if (-1 == ece391_write (1, buf, len))
 	        return 3;
     }
 
@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* prof start|stop|reset|dump -- control the kernel profiler.
+ * "cat profile" prints the collected samples. */
+int main ()
+{
+    int32_t fd;
+    uint8_t buf[1024];
+
+    if (0 != ece391_getargs (buf, 1024)) {
+        ece391_fdputs (1, (uint8_t*)"usage: prof start|stop|reset|dump\n");
+	return 3;
+    }
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"profile"))) {
+        ece391_fdputs (1, (uint8_t*)"no profile device\n");
+	return 2;
+    }
+
+    if (-1 == ece391_write (fd, buf, ece391_strlen (buf))) {
+        ece391_fdputs (1, (uint8_t*)"usage: prof start|stop|reset|dump\n");
+	return 3;
+    }
+
+    ece391_close (fd);
+    return 0;
+}
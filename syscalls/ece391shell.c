@@ -4,6 +4,80 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 8
+
+/* Where the shell keeps its own stdin and stdout while a pipeline runs */
+#define SAVED_STDIN  6
+#define SAVED_STDOUT 7
+
+/* 
+ * Runs "a | b | c", each stage's stdout feeding the next one's stdin.
+ * A stage writing into a pipe runs alongside the shell, so execute only
+ * waits for the last one. Returns what that one did, or -1 if any stage
+ * could not be started.
+ */
+static int32_t
+run_pipeline (uint8_t* buf)
+{
+    uint8_t* stage[MAX_STAGES];
+    int32_t nstages, i, fds[2], rval, failed;
+    uint8_t* s;
+
+    /* Split at each '|' and drop the spaces around the stages */
+    nstages = 0;
+    for (s = buf; nstages < MAX_STAGES; s++) {
+	while (' ' == *s)
+	    s++;
+	stage[nstages++] = s;
+	while ('\0' != *s && '|' != *s)
+	    s++;
+	for (i = 0; s - i > stage[nstages - 1] && ' ' == s[-i - 1]; i++)
+	    s[-i - 1] = '\0';
+	if ('\0' == *s)
+	    break;
+	*s = '\0';
+    }
+    if ('\0' != *s)
+	return -1;
+    for (i = 0; i < nstages; i++)
+	if ('\0' == stage[i][0])
+	    return -1;
+
+    if (-1 == ece391_dup2 (0, SAVED_STDIN) || -1 == ece391_dup2 (1, SAVED_STDOUT))
+	return -1;
+
+    failed = 0;
+    rval = 0;
+    for (i = 0; i < nstages; i++) {
+	if (i < nstages - 1) {
+	    if (-1 == ece391_pipe (fds)) {
+		failed = 1;
+		break;
+	    }
+	    ece391_dup2 (fds[1], 1);
+	    ece391_close (fds[1]);
+	} else {
+	    ece391_dup2 (SAVED_STDOUT, 1);
+	}
+
+	rval = ece391_execute (stage[i]);
+	if (-1 == rval)
+	    failed = 1;
+
+	/* The next stage reads what this one writes; the shell keeps no */
+	/* write end open, so it sees end of file once this one halts    */
+	if (i < nstages - 1) {
+	    ece391_dup2 (fds[0], 0);
+	    ece391_close (fds[0]);
+	}
+    }
+
+    ece391_dup2 (SAVED_STDIN, 0);
+    ece391_dup2 (SAVED_STDOUT, 1);
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    return failed ? -1 : rval;
+}
 
 int main ()
 {
@@ -24,7 +98,11 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
+	for (cnt = 0; '\0' != buf[cnt] && '|' != buf[cnt]; cnt++);
+	if ('|' == buf[cnt])
+	    rval = run_pipeline (buf);
+	else
+	    rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
 	else if (256 == rval)
@@ -5,6 +5,14 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* What stat and fstat fill in */
+typedef struct stat {
+	uint32_t file_type;	/* 0 rtc, 1 directory, 2 file, 3 terminal or device */
+	uint32_t inode_index;
+	uint32_t size;		/* bytes, regular files only */
+	uint32_t blocks;	/* 4 kB data blocks */
+} stat_t;
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +29,29 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_vidmap_buffered (uint8_t** screen_start);
+extern int32_t ece391_present (void);
+extern int32_t ece391_pipe (int32_t fds[2]);
+extern int32_t ece391_dup2 (int32_t oldfd, int32_t newfd);
+extern int32_t ece391_sendfile (int32_t out_fd, int32_t in_fd, int32_t nbytes);
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_stat (const uint8_t* filename, stat_t* buf);
+extern int32_t ece391_fstat (int32_t fd, stat_t* buf);
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+
+/* One record filled in by getdents */
+typedef struct dirent {
+	uint8_t name[32];	/* not terminated if 32 long */
+	uint32_t file_type;	/* 0 rtc, 1 directory, 2 file */
+	uint32_t inode_index;
+	uint32_t size;		/* bytes, regular files only */
+} dirent_t;
+
+/* lseek whence */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
 
 enum signums {
 	DIV_ZERO = 0,
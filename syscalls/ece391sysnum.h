@@ -11,5 +11,15 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_VIDMAP_BUFFERED  11
+#define SYS_PRESENT  12
+#define SYS_PIPE  13
+#define SYS_DUP2  14
+#define SYS_SENDFILE  15
+#define SYS_GETDENTS  16
+#define SYS_STAT  17
+#define SYS_FSTAT  18
+#define SYS_LSEEK  19
+#define SYS_PREAD  20
 
 #endif /* ECE391SYSNUM_H */
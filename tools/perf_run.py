@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Boot the kernel headless in QEMU, collect benchmark results from the
+serial port and compare them with a stored baseline.
+
+The kernel prints "@bench <name> <iters> <min> <median> <p99>" lines (see
+student-distrib/tests/benchmark.c). A build made with PERF_EXIT powers QEMU
+off through isa-debug-exit when the benchmarks are done. With --workload, a
+build with the PIT enabled is expected instead: every line of the workload
+file is sent to the shell on the serial terminal, and the host times each
+command until the next prompt.
+
+Every baseline entry the run should produce has to be there: shell:*
+entries with --workload, all others always. A run against an empty or
+missing baseline fails unless --update-baseline records one.
+
+Exit status: 0 when nothing regressed, 1 on a regression, 2 when the run
+itself failed: QEMU did not exit cleanly, a benchmark is missing, or there
+is no baseline to compare against.
+
+usage: perf_run.py --kernel bootimg --fs filesys_img [--baseline FILE]
+                   [--workload FILE] [--tolerance 10] [--update-baseline]
+"""
+
+import argparse
+import os
+import re
+import select
+import subprocess
+import sys
+import time
+
+BENCH_RE = re.compile(rb"@bench (\S+) (\d+) (\d+) (\d+) (\d+)")
+DONE = b"@bench-done"
+PROMPT = b"391OS> "
+# isa-debug-exit turns the value v written by the kernel into status (v << 1) | 1
+QEMU_CLEAN_EXIT = 1
+
+
+def qemu_command(args):
+    return [
+        args.qemu, "-m", "256", "-display", "none", "-no-reboot",
+        "-kernel", args.kernel, "-initrd", args.fs,
+        "-serial", "stdio", "-monitor", "none",
+        "-device", "isa-debug-exit,iobase=0xf4,iosize=0x04",
+    ]
+
+
+class Console:
+    """Serial port of a running QEMU, with everything read kept in log."""
+
+    def __init__(self, proc):
+        self.proc = proc
+        self.log = b""
+
+    def read_until(self, marker, start, timeout):
+        deadline = time.time() + timeout
+        while marker not in self.log[start:]:
+            remaining = deadline - time.time()
+            if remaining <= 0 or self.proc.poll() is not None:
+                return False
+            ready, _, _ = select.select([self.proc.stdout], [], [], remaining)
+            if ready:
+                chunk = os.read(self.proc.stdout.fileno(), 65536)
+                if not chunk:
+                    return False
+                self.log += chunk
+        return True
+
+    def send(self, line):
+        self.proc.stdin.write(line.encode() + b"\n")
+        self.proc.stdin.flush()
+
+
+def run(args):
+    proc = subprocess.Popen(qemu_command(args), stdin=subprocess.PIPE,
+                            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    con = Console(proc)
+    timings = []
+    try:
+        if not con.read_until(DONE, 0, args.timeout):
+            print("benchmarks did not finish", file=sys.stderr)
+            return None, con.log
+        if args.workload:
+            if not con.read_until(PROMPT, 0, args.timeout):
+                print("no shell on the serial terminal", file=sys.stderr)
+                return None, con.log
+            with open(args.workload) as f:
+                commands = [l.strip() for l in f if l.strip() and not l.startswith("#")]
+            for cmd in commands:
+                mark = len(con.log)
+                start = time.time()
+                con.send(cmd)
+                if not con.read_until(PROMPT, mark, args.timeout):
+                    print("command timed out: %s" % cmd, file=sys.stderr)
+                    return None, con.log
+                timings.append((cmd, time.time() - start))
+        else:
+            proc.wait(args.timeout)
+            if proc.returncode != QEMU_CLEAN_EXIT:
+                print("qemu exited with %s" % proc.returncode, file=sys.stderr)
+                return None, con.log
+    except subprocess.TimeoutExpired:
+        print("qemu did not exit", file=sys.stderr)
+        return None, con.log
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait()
+
+    results = {}
+    for m in BENCH_RE.finditer(con.log):
+        name = m.group(1).decode()
+        results[name] = tuple(int(m.group(i)) for i in range(2, 6))
+    for cmd, seconds in timings:
+        results["shell:" + cmd.replace(" ", "_")] = (1, 0, int(seconds * 1e6), 0)
+    return results, con.log
+
+
+def load_baseline(path):
+    """name -> (median, tolerance percent or None)"""
+    baseline = {}
+    if not path or not os.path.exists(path):
+        return baseline
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].split()
+            if len(line) >= 2:
+                baseline[line[0]] = (int(line[1]), float(line[2]) if len(line) > 2 else None)
+    return baseline
+
+
+def expected(name, args):
+    """Whether a run with these arguments produces the entry"""
+    return args.workload is not None or not name.startswith("shell:")
+
+
+def save_baseline(path, results, old, args):
+    """Entries this kind of run doesn't produce are kept as they were"""
+    medians = dict((name, results[name][2]) for name in results)
+    for name in old:
+        if not expected(name, args):
+            medians[name] = old[name][0]
+    with open(path, "w") as f:
+        f.write("# name  median  [tolerance %]  -- written by perf_run.py --update-baseline\n")
+        f.write("# benchmark medians are cycles, shell:* entries are microseconds\n")
+        for name in sorted(medians):
+            tol = old.get(name, (0, None))[1]
+            f.write("%s %d%s\n" % (name, medians[name], "" if tol is None else " %g" % tol))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--kernel", default="bootimg")
+    parser.add_argument("--fs", default="filesys_img")
+    parser.add_argument("--baseline", help="stored results to compare against")
+    parser.add_argument("--workload", help="shell commands to run on the serial terminal")
+    parser.add_argument("--tolerance", type=float, default=10.0,
+                        help="allowed median slowdown in percent (default 10)")
+    parser.add_argument("--timeout", type=float, default=120.0)
+    parser.add_argument("--qemu", default="qemu-system-i386")
+    parser.add_argument("--log", help="save the raw serial output here")
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args()
+    if args.update_baseline and not args.baseline:
+        parser.error("--update-baseline needs --baseline")
+
+    results, log = run(args)
+    if args.log:
+        with open(args.log, "wb") as f:
+            f.write(log)
+    if not results:
+        return 2
+
+    baseline = load_baseline(args.baseline)
+    regressed = False
+    missing = [name for name in baseline if expected(name, args) and name not in results]
+    print("%-28s %10s %10s %10s %10s  %s" % ("benchmark", "min", "median", "p99", "base", "change"))
+    for name in sorted(results):
+        _, lo, med, p99 = results[name]
+        if name in baseline:
+            base, tol = baseline[name]
+            tol = args.tolerance if tol is None else tol
+            change = 100.0 * (med - base) / base if base else 0.0
+            verdict = "REGRESSED" if change > tol else ""
+            regressed |= change > tol
+            print("%-28s %10d %10d %10d %10d  %+6.1f%% %s" % (name, lo, med, p99, base, change, verdict))
+        else:
+            print("%-28s %10d %10d %10d %10s  new" % (name, lo, med, p99, "-"))
+    for name in sorted(missing):
+        print("%-28s %10s %10s %10s %10d  MISSING" % (name, "-", "-", "-", baseline[name][0]))
+
+    if args.update_baseline:
+        save_baseline(args.baseline, results, baseline, args)
+        return 0
+    if not baseline:
+        print("no baseline to compare against; record one with --update-baseline",
+              file=sys.stderr)
+        return 2
+    if missing:
+        print("%d benchmark(s) in the baseline did not run" % len(missing), file=sys.stderr)
+        return 2
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
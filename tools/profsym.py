@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Turn the kernel profiler's dump into flat profiles.
+
+Reads the "@prof" lines written by "cat profile" or "prof dump" (see
+student-distrib/profile.h) from a serial capture or a saved screen, and
+symbolizes each sample against the kernel image and the user programs.
+Kernel samples are resolved with student-distrib/bootimg. User samples are
+resolved with the unstripped <name>.exe next to the program's sources,
+because the copies in fsdir/ are stripped.
+
+usage: profsym.py serial.log [--top 20]
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+KERNEL_IMAGE = os.path.join(ROOT, "student-distrib", "bootimg")
+USER_DIRS = [os.path.join(ROOT, "syscalls"), os.path.join(ROOT, "fish")]
+
+KERNEL_START, KERNEL_END = 0x400000, 0x800000
+
+NAME_RE = re.compile(r"@prof-name (\d+) (\S+)")
+SAMPLE_RE = re.compile(r"@prof (\d+) ([0-9A-Fa-f]+) (\d+)")
+DROPPED_RE = re.compile(r"@prof-dropped (\d+)")
+
+
+class Symbols:
+    """Address to function lookup built from nm -n."""
+
+    def __init__(self, path):
+        self.addrs, self.names = [], []
+        if not path or not os.path.exists(path):
+            return
+        out = subprocess.run(["nm", "-n", path], capture_output=True, text=True).stdout
+        for line in out.splitlines():
+            parts = line.split()
+            if len(parts) == 3 and parts[1] in "tTwW":
+                self.addrs.append(int(parts[0], 16))
+                self.names.append(parts[2])
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%08x" % addr
+        return self.names[i]
+
+
+def user_image(program):
+    for d in USER_DIRS:
+        for name in (program + ".exe", "ece391" + program + ".exe"):
+            path = os.path.join(d, name)
+            if os.path.exists(path):
+                return path
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="file containing the profile dump")
+    parser.add_argument("--top", type=int, default=20, help="functions shown per profile")
+    args = parser.parse_args()
+
+    names = {}
+    samples = []
+    dropped = 0
+    with open(args.log, "r", errors="replace") as f:
+        for line in f:
+            m = NAME_RE.search(line)
+            if m:
+                names[int(m.group(1))] = m.group(2)
+                continue
+            m = SAMPLE_RE.search(line)
+            if m:
+                samples.append((int(m.group(1)), int(m.group(2), 16), int(m.group(3))))
+                continue
+            m = DROPPED_RE.search(line)
+            if m:
+                dropped = int(m.group(1))
+
+    kernel = Symbols(KERNEL_IMAGE)
+    user_syms = {}
+    profiles = collections.defaultdict(collections.Counter)
+
+    for pid, eip, count in samples:
+        if KERNEL_START <= eip < KERNEL_END:
+            profiles["kernel"][kernel.lookup(eip)] += count
+            continue
+        program = names.get(pid, "pid %d" % pid)
+        if program not in user_syms:
+            user_syms[program] = Symbols(user_image(program))
+        profiles[program][user_syms[program].lookup(eip)] += count
+
+    for program in sorted(profiles, key=lambda p: -sum(profiles[p].values())):
+        hist = profiles[program]
+        total = sum(hist.values())
+        print("== %s: %d samples" % (program, total))
+        for func, count in hist.most_common(args.top):
+            print("%6.2f%% %8d  %s" % (100.0 * count / total, count, func))
+        print()
+    if dropped:
+        print("warning: %d samples dropped, profile table was full" % dropped, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Convert a kernel trace captured from the serial port into Chrome trace
+JSON (load it in chrome://tracing or ui.perfetto.dev).
+
+The kernel writes batches of the form (see student-distrib/trace.h):
+
+    "TRC1" | u32 count | u32 lost | count * {u64 tsc, u32 arg, u16 pid, u8 type, u8 lap}
+
+interleaved with ordinary console text, which is skipped.
+
+usage: trace2json.py serial.log [--mhz 2000] > trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"TRC1"
+HEADER = struct.Struct("<II")
+RECORD = struct.Struct("<QIHBB")
+NO_PID = 0xFFFF
+
+SYSCALLS = {
+    1: "halt", 2: "execute", 3: "read", 4: "write", 5: "open", 6: "close",
+    7: "getargs", 8: "vidmap", 9: "set_handler", 10: "sigreturn",
+    11: "vidmap_buffered", 12: "present", 13: "pipe", 14: "dup2",
+    15: "sendfile",
+    16: "getdents",
+    17: "stat",
+    18: "fstat",
+    19: "lseek",
+    20: "pread",
+}
+
+SYSCALL_ENTER, SYSCALL_EXIT, IRQ_ENTER, IRQ_EXIT, SWITCH, PAGE_FAULT, \
+    EXECUTE, HALT = range(8)
+
+
+def records(data):
+    """Yield (record tuple) for every record in every batch, and report
+    records the kernel dropped."""
+    pos = 0
+    while True:
+        pos = data.find(MAGIC, pos)
+        if pos < 0 or pos + len(MAGIC) + HEADER.size > len(data):
+            return
+        count, lost = HEADER.unpack_from(data, pos + len(MAGIC))
+        pos += len(MAGIC) + HEADER.size
+        if lost:
+            print("warning: %d records lost" % lost, file=sys.stderr)
+        for _ in range(count):
+            if pos + RECORD.size > len(data):
+                return
+            yield RECORD.unpack_from(data, pos)
+            pos += RECORD.size
+
+
+def convert(data, mhz):
+    events = []
+    start = None
+    open_syscalls = {}
+
+    for tsc, arg, pid, etype, _lap in records(data):
+        if start is None:
+            start = tsc
+        ts = (tsc - start) / mhz
+        tid = "idle" if pid == NO_PID else "pid %d" % pid
+        ev = {"ts": ts, "pid": 0, "tid": tid}
+
+        if etype == SYSCALL_ENTER:
+            open_syscalls[pid] = arg
+            ev.update(ph="B", name=SYSCALLS.get(arg, "syscall %d" % arg), cat="syscall")
+        elif etype == SYSCALL_EXIT:
+            if pid not in open_syscalls:
+                continue
+            ev.update(ph="E", name=SYSCALLS.get(open_syscalls.pop(pid), "syscall"),
+                      cat="syscall", args={"ret": struct.unpack("<i", struct.pack("<I", arg))[0]})
+        elif etype == IRQ_ENTER:
+            ev.update(ph="B", name="IRQ%d" % arg, cat="irq", tid="irq")
+        elif etype == IRQ_EXIT:
+            ev.update(ph="E", name="IRQ%d" % arg, cat="irq", tid="irq")
+        elif etype == SWITCH:
+            ev.update(ph="i", s="g", name="switch to pid %d" % arg, cat="sched")
+        elif etype == PAGE_FAULT:
+            ev.update(ph="i", s="g", name="page fault 0x%08x" % arg, cat="fault")
+        elif etype == EXECUTE:
+            ev.update(ph="i", s="t", name="execute pid %d" % arg, cat="proc")
+        elif etype == HALT:
+            ev.update(ph="i", s="t", name="halt(%d)" % arg, cat="proc")
+        else:
+            continue
+        events.append(ev)
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="raw serial capture")
+    parser.add_argument("--mhz", type=float, default=1000.0,
+                        help="TSC frequency in MHz (default 1000)")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+    json.dump(convert(data, args.mhz), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()